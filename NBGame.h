@@ -61,6 +61,13 @@ public:
 	}
 
 	void play();
+	void setStatsLog(ostream *log);
+	void setNumThreads(int numThreads);
+	void setSeed(uint64_t seed);
+	void setBudget(int player, const SearchBudget &budget);
+	void setPlayoutPolicy(const PlayoutPolicy &policy);
+	void setProofNodes(uint64_t maxNodes);
+	void setMemoryLimit(size_t bytes);
 };
 
 /**
@@ -74,6 +81,77 @@ void NBGame::play()
 	gameLoop();
 }
 
+/**
+ * @brief Writes a JSON record with the search statistics of every computer move to the stream.
+ *
+ * @param log The stream to write to, or nullptr to disable logging.
+ */
+void NBGame::setStatsLog(ostream *log)
+{
+	playerManager.setStatsLog(log);
+}
+
+/**
+ * @brief Sets the number of threads the computer players may search with.
+ *
+ * @param numThreads The number of threads, 0 for one per hardware thread.
+ */
+void NBGame::setNumThreads(int numThreads)
+{
+	playerManager.setNumThreads(numThreads);
+}
+
+/**
+ * @brief Seeds the computer players so the same game can be played again.
+ *
+ * @param seed The seed.
+ */
+void NBGame::setSeed(uint64_t seed)
+{
+	playerManager.setSeed(seed);
+}
+
+/**
+ * @brief Gives a computer player a search budget per move, so it isn't asked for one.
+ *
+ * @param player The player, 1 or -1.
+ * @param budget The playouts and/or time per move.
+ */
+void NBGame::setBudget(int player, const SearchBudget &budget)
+{
+	playerManager.setBudget(player, budget);
+}
+
+/**
+ * @brief Switches the playouts of the Monte Carlo and MCTS players to heavy moves.
+ *
+ * @param policy Random or heavy playouts.
+ */
+void NBGame::setPlayoutPolicy(const PlayoutPolicy &policy)
+{
+	playerManager.setPlayoutPolicy(policy);
+}
+
+/**
+ * @brief Makes the Advanced Minimax players look for a forced win before every search.
+ *
+ * @param maxNodes The most proof search nodes per move, 0 to turn it off.
+ */
+void NBGame::setProofNodes(uint64_t maxNodes)
+{
+	playerManager.setProofNodes(maxNodes);
+}
+
+/**
+ * @brief Caps the memory of the MCTS players' trees. They prune it when it fills up.
+ *
+ * @param bytes The most each tree may take, 0 for no cap.
+ */
+void NBGame::setMemoryLimit(size_t bytes)
+{
+	playerManager.setMemoryLimit(bytes);
+}
+
 void NBGame::start()
 {
 	// Start the game with a menu screen.
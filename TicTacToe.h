@@ -10,6 +10,8 @@
 
 #include "./struct/Move.h"
 
+#include <cstdint>
+
 const int SIZE = 3;
 
 class TicTacToe
@@ -17,6 +19,9 @@ class TicTacToe
 private:
 	int board[SIZE][SIZE];
 
+	// One bit per cell (row * 3 + col) for player 1 and player -1 respectively.
+	uint16_t masks[2];
+
 public:
 	/**
 	 * @brief Constructor
@@ -40,6 +45,10 @@ public:
 
 	// Getter for the number of moves
 	int getNoOfMoves();
+
+	// Getters for the bitmasks
+	uint16_t getMask(const int player) const;
+	uint16_t getEmptyMask() const;
 };
 
 TicTacToe::TicTacToe()
@@ -52,6 +61,10 @@ TicTacToe::TicTacToe()
 	// Set the number of moves
 	this->noOfMoves = 0;
 
+	// No cells are taken.
+	this->masks[0] = 0;
+	this->masks[1] = 0;
+
 	// // Uncomment to test draw states and comment the above code.
 	// board[0][0] = 0;
 	// board[0][1] = 1;
@@ -115,6 +128,13 @@ void TicTacToe::addMove(int x, int y, int player)
 
 	// Add move
 	this->board[x][y] = player;
+
+	// Keep the bitmasks in sync. Undoing a move (player 0) clears the cell for both players.
+	uint16_t bit = (uint16_t)(1 << (x * SIZE + y));
+	this->masks[0] &= ~bit;
+	this->masks[1] &= ~bit;
+	if (player != 0)
+		this->masks[player == 1 ? 0 : 1] |= bit;
 }
 
 /**
@@ -129,6 +149,7 @@ void TicTacToe::addMove(const Move *player)
 
 	// Add move
 	this->board[player->x][player->y] = player->currentPlayer;
+	this->masks[player->currentPlayer == 1 ? 0 : 1] |= (uint16_t)(1 << (player->x * SIZE + player->y));
 }
 
 /**
@@ -172,4 +193,24 @@ int TicTacToe::getNoOfMoves() {
 	return this->noOfMoves;
 }
 
+/**
+ * @brief Gets the cells held by a player as a bitmask
+ *
+ * Bit (x * 3 + y) is set when the player holds cell x, y.
+ *
+ * @param player The player, 1 or -1.
+ */
+uint16_t TicTacToe::getMask(const int player) const
+{
+	return this->masks[player == 1 ? 0 : 1];
+}
+
+/**
+ * @brief Gets the empty cells as a bitmask
+ */
+uint16_t TicTacToe::getEmptyMask() const
+{
+	return (uint16_t)(~(this->masks[0] | this->masks[1]) & 0x1FF);
+}
+
 #endif
@@ -8,15 +8,102 @@ is lost or damaged.
 **************************/
 
 #include <iostream>
+#include <cstdlib>
+#include <cstring>
 
 using namespace std;
 
 #include "NBGame.h"
 
-int main()
+int main(int argc, char *argv[])
 {
 	NBGame game; // Create a new object from the TicTacToe class and name it 'game', this process is called instantiation.
 
+	// --stats writes the search statistics of each computer move to stderr as one JSON line.
+	// --threads=<n> lets the computer players search on n threads (0 = all cores).
+	// --seed=<n> makes the computer players' moves repeatable.
+	// --budget=<b>, --p1-budget=<b> and --p2-budget=<b> give the Monte Carlo and MCTS players
+	// a budget per move, e.g. 20000 playouts, 250ms or 20000,250ms.
+	// --heavy-playouts[=<epsilon>] makes their playouts win, block and prefer the centre and
+	// corners, with a random move a share epsilon of the time.
+	// --tablebase=<file> lets Advanced Minimax look up the exact value of late positions in
+	// a tablebase built by tools/TablebaseGen.cpp.
+	// --book=<file> makes the searching computer players take their opening moves from a
+	// book built by tools/OpeningBookGen.cpp.
+	// --dfpn[=<nodes>] lets Advanced Minimax prove forced wins with a proof number search
+	// of up to <nodes> nodes before each move.
+	// --proofdb=<file> gives that search the positions settled by tools/GameSolver.cpp.
+	// --mcts-memory=<MB> caps the tree of each MCTS player, which prunes it when it fills up.
+	for (int i = 1; i < argc; i++)
+	{
+		SearchBudget budget;
+		if (strcmp(argv[i], "--stats") == 0)
+			game.setStatsLog(&cerr);
+		else if (strncmp(argv[i], "--threads=", 10) == 0)
+			game.setNumThreads(atoi(argv[i] + 10));
+		else if (strncmp(argv[i], "--seed=", 7) == 0)
+			game.setSeed(strtoull(argv[i] + 7, nullptr, 10));
+		else if (strncmp(argv[i], "--budget=", 9) == 0 && SearchBudget::parse(argv[i] + 9, &budget))
+		{
+			game.setBudget(1, budget);
+			game.setBudget(-1, budget);
+		}
+		else if (strncmp(argv[i], "--p1-budget=", 12) == 0 && SearchBudget::parse(argv[i] + 12, &budget))
+			game.setBudget(1, budget);
+		else if (strncmp(argv[i], "--p2-budget=", 12) == 0 && SearchBudget::parse(argv[i] + 12, &budget))
+			game.setBudget(-1, budget);
+		else if (strcmp(argv[i], "--heavy-playouts") == 0)
+			game.setPlayoutPolicy(PlayoutPolicy(true, PlayoutPolicy().epsilon));
+		else if (strncmp(argv[i], "--heavy-playouts=", 17) == 0)
+		{
+			PlayoutPolicy policy;
+			if (PlayoutPolicy::parse(argv[i] + 17, &policy))
+				game.setPlayoutPolicy(policy);
+			else
+				cerr << "Invalid epsilon " << argv[i] + 17 << ", expected a number from 0 to 1" << endl;
+		}
+		else if (strncmp(argv[i], "--tablebase=", 12) == 0 && !Tablebase::instance().open(argv[i] + 12))
+			cerr << "Could not open tablebase " << argv[i] + 12 << endl;
+		else if (strncmp(argv[i], "--book=", 7) == 0 && !OpeningBook::instance().open(argv[i] + 7))
+			cerr << "Could not open opening book " << argv[i] + 7 << endl;
+		else if (strcmp(argv[i], "--dfpn") == 0)
+			game.setProofNodes(ADVANCED_MINIMAX_PROOF_NODES);
+		else if (strncmp(argv[i], "--dfpn=", 7) == 0)
+			game.setProofNodes(strtoull(argv[i] + 7, nullptr, 10));
+		else if (strncmp(argv[i], "--proofdb=", 10) == 0 && !ProofDatabase::instance().open(argv[i] + 10))
+			cerr << "Could not open proof database " << argv[i] + 10 << endl;
+		else if (strncmp(argv[i], "--mcts-memory=", 14) == 0)
+		{
+			char *end;
+			unsigned long long megabytes = strtoull(argv[i] + 14, &end, 10);
+			if (end != argv[i] + 14 && *end == '\0' && megabytes > 0)
+				game.setMemoryLimit((size_t)megabytes << 20);
+			else
+				cerr << "Invalid memory cap " << argv[i] + 14 << ", expected a number of MB" << endl;
+		}
+		else if (strstr(argv[i], "budget=") != nullptr)
+			cerr << "Invalid budget " << argv[i] << ", expected e.g. 20000, 250ms or 20000,250ms" << endl;
+	}
+
+#ifdef NBTTT_SEARCH_TRACE
+	// --trace=<file> streams the Advanced Minimax search tree to a binary file.
+	// --trace-depth=<n> and --trace-sample=<n> bound its size.
+	const char *tracePath = nullptr;
+	int traceDepth = 64, traceSample = 1;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strncmp(argv[i], "--trace=", 8) == 0)
+			tracePath = argv[i] + 8;
+		else if (strncmp(argv[i], "--trace-depth=", 14) == 0)
+			traceDepth = atoi(argv[i] + 14);
+		else if (strncmp(argv[i], "--trace-sample=", 15) == 0)
+			traceSample = atoi(argv[i] + 15);
+	}
+
+	if (tracePath != nullptr && !SearchTrace::instance().open(tracePath, traceDepth, traceSample, 1 << 20))
+		cerr << "Could not open trace file " << tracePath << endl;
+#endif
+
 	game.play(); // Start game
 
 	return 0;
@@ -2,11 +2,19 @@
 #define ALGORITHM_H
 
 #include "../../TicTacToe.h"
+#include "../../helpers/Random.h"
 #include "../../struct/Coordinate.h"
+#include "../../struct/PlayoutPolicy.h"
+#include "../../struct/SearchBudget.h"
+#include "./OpeningBook.h"
+#include "./SearchStats.h"
 
+#include <chrono>
 #include <ctime>
 #include <cstdlib>
+#include <iostream>
 #include <limits>
+#include <string>
 
 using namespace std;
 
@@ -28,6 +36,17 @@ protected:
     int player;
     int enemyPlayer;
     TicTacToe (*grid)[3][3];
+    Random random;
+
+    // SEARCH STATISTICS
+    SearchStats stats;
+    ostream *statsLog;
+    chrono::steady_clock::time_point searchStart;
+
+    void beginSearch();
+    void endSearch(int x, int y);
+    double getElapsedMs() const;
+    bool playBookMove(int *x, int *y, const Coordinate *currentBoard);
 
 public:
     /**
@@ -38,7 +57,8 @@ public:
      */
     Algorithm(TicTacToe (*grid)[3][3], int player)
         : grid(grid),
-          player(player)
+          player(player),
+          statsLog(nullptr)
     {
         // Set enemy player
         this->enemyPlayer = player == 1 ? PLAYER_TWO : PLAYER_ONE;
@@ -46,9 +66,123 @@ public:
         // Seed randomization
         srand(time(0));
     }
+
+    // Engines own arenas and thread pools, which must be freed through a base pointer too.
+    virtual ~Algorithm() {}
     
     // Virtual method to be implemented by derived classes.
     virtual void useAlgorithm(int *x, int *y, const Coordinate *currentBoard) = 0;
+    virtual string getName() const = 0;
+
+    // Engines that can search on several threads override this.
+    virtual void setNumThreads(int /*numThreads*/) {}
+
+    // Sampling engines override this to search until the budget is used up.
+    virtual void setBudget(const SearchBudget &/*budget*/) {}
+
+    // Sampling engines override this to change how their playouts pick moves.
+    virtual void setPlayoutPolicy(const PlayoutPolicy &/*policy*/) {}
+
+    // Minimax overrides this to look for a forced win before its own search.
+    virtual void setProofNodes(uint64_t /*maxNodes*/) {}
+
+    // Tree searches override this to cap the memory of their tree.
+    virtual void setMemoryLimit(size_t /*bytes*/) {}
+
+    const SearchStats &getStats() const;
+    void setStatsLog(ostream *log);
+    void setSeed(uint64_t seed);
 };
 
-#endif
\ No newline at end of file
+/**
+ * @brief Resets the statistics and starts the clock for a new move.
+ *
+ * Derived classes call this at the top of useAlgorithm().
+ */
+void Algorithm::beginSearch()
+{
+    this->stats.reset();
+    this->searchStart = chrono::steady_clock::now();
+}
+
+/**
+ * @brief Stops the clock and writes the JSON record if logging is enabled.
+ *
+ * Derived classes call this once the move has been chosen.
+ *
+ * @param x The row of the chosen move.
+ * @param y The column of the chosen move.
+ */
+void Algorithm::endSearch(int x, int y)
+{
+    this->stats.elapsedMs = getElapsedMs();
+
+    if (this->statsLog != nullptr)
+    {
+        *this->statsLog << this->stats.toJson(getName(), this->player, x, y) << endl;
+    }
+}
+
+/**
+ * @brief Time since beginSearch(), in milliseconds. Safe to call from any thread.
+ */
+double Algorithm::getElapsedMs() const
+{
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - this->searchStart;
+    return elapsed.count();
+}
+
+/**
+ * @brief Takes the move from the opening book, when one is open and has the position.
+ *
+ * Searching engines call this after beginSearch() and skip their search when it succeeds.
+ *
+ * @param x Receives the row of the book move.
+ * @param y Receives the column of the book move.
+ * @param currentBoard The board the move must be played on.
+ * @return `true` if the book had a move.
+ */
+bool Algorithm::playBookMove(int *x, int *y, const Coordinate *currentBoard)
+{
+    const OpeningBook &book = OpeningBook::instance();
+    int move;
+
+    if (!book.isOpen() || !book.probe(Position::fromGrid(this->grid, currentBoard, this->player), move))
+        return false;
+
+    *x = move % 9 / BOARD_SIZE;
+    *y = move % 9 % BOARD_SIZE;
+    this->stats.cacheHits++;
+
+    return true;
+}
+
+/**
+ * @brief Gets the statistics of the last move.
+ */
+const SearchStats &Algorithm::getStats() const
+{
+    return this->stats;
+}
+
+/**
+ * @brief Enables one JSON line per move on the given stream. Pass nullptr to disable.
+ *
+ * @param log The stream to write the records to.
+ */
+void Algorithm::setStatsLog(ostream *log)
+{
+    this->statsLog = log;
+}
+
+/**
+ * @brief Restarts the random stream of the engine, so its searches can be repeated.
+ *
+ * @param seed The seed. The same seed gives the same moves for the same positions.
+ */
+void Algorithm::setSeed(uint64_t seed)
+{
+    this->random.seed(seed);
+}
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef OPENINGBOOK_H
+#define OPENINGBOOK_H
+
+#include "../../helpers/MappedFile.h"
+#include "./Position.h"
+#include "./Symmetry.h"
+
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+// Opening book: the move a deep offline search chose for every position of the first plies.
+//
+// tools/OpeningBookGen.cpp builds the file and the engines read it through a memory
+// mapping, see OpeningBook.
+
+const uint32_t OPENING_BOOK_MAGIC = 0x424f424e; // "NBOB"
+const uint32_t OPENING_BOOK_VERSION = 1;
+const int OPENING_BOOK_DEFAULT_PLIES = 4;
+
+/**
+ * @brief File header of an opening book.
+ *
+ * It is followed by `count` sorted keys (uint64_t) and then `count` moves (uint8_t,
+ * board * 9 + cell), the move of key i at index i.
+ */
+struct OpeningBookHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t keySize;
+    uint32_t moveSize;
+    uint32_t plies; // Every position with fewer pieces than this is stored.
+    uint32_t reserved;
+    uint64_t count;
+};
+
+static_assert(sizeof(OpeningBookHeader) == 32, "OpeningBookHeader must stay 32 bytes");
+
+/**
+ * @brief Read only access to an opening book file.
+ *
+ * Positions are keyed by the smallest Zobrist hash over the 8 symmetries of the grid,
+ * and the move is stored for that orientation. A probe maps the position the same way,
+ * binary searches the sorted keys and maps the move back. There is a single process wide
+ * book, opened by the application.
+ */
+class OpeningBook
+{
+private:
+    MappedFile file;
+    const uint64_t *keys;
+    const uint8_t *moves;
+    uint64_t count;
+    int plies;
+
+    OpeningBook() : keys(nullptr), moves(nullptr), count(0), plies(0) {}
+
+public:
+    static OpeningBook &instance();
+    static uint64_t getKey(const Position &position, int &symmetry);
+
+    bool open(const char *path);
+    void close();
+    bool probe(const Position &position, int &move) const;
+
+    bool isOpen() const
+    {
+        return this->keys != nullptr;
+    }
+
+    int getPlies() const
+    {
+        return this->plies;
+    }
+};
+
+OpeningBook &OpeningBook::instance()
+{
+    static OpeningBook book;
+    return book;
+}
+
+/**
+ * @brief The key a position is stored under.
+ *
+ * @param position The position.
+ * @param symmetry Receives the symmetry that maps the position onto the stored one.
+ * @return The smallest hash over the symmetries.
+ */
+uint64_t OpeningBook::getKey(const Position &position, int &symmetry)
+{
+    return Symmetry::canonicalHash(position, symmetry);
+}
+
+/**
+ * @brief Maps an opening book file and checks its header.
+ *
+ * @param path The file written by tools/OpeningBookGen.cpp.
+ * @return `true` if the file is an opening book of this version.
+ */
+bool OpeningBook::open(const char *path)
+{
+    close();
+
+    if (!this->file.open(path))
+        return false;
+
+    const OpeningBookHeader *header = (const OpeningBookHeader *)this->file.getData();
+    if (this->file.getSize() < sizeof(OpeningBookHeader) || header->magic != OPENING_BOOK_MAGIC ||
+        header->version != OPENING_BOOK_VERSION || header->keySize != sizeof(uint64_t) ||
+        header->moveSize != sizeof(uint8_t) ||
+        this->file.getSize() != sizeof(OpeningBookHeader) + header->count * (sizeof(uint64_t) + sizeof(uint8_t)))
+    {
+        this->file.close();
+        return false;
+    }
+
+    this->count = header->count;
+    this->plies = (int)header->plies;
+    this->keys = (const uint64_t *)(this->file.getData() + sizeof(OpeningBookHeader));
+    this->moves = (const uint8_t *)(this->keys + this->count);
+
+    return true;
+}
+
+void OpeningBook::close()
+{
+    this->file.close();
+    this->keys = nullptr;
+    this->moves = nullptr;
+    this->count = 0;
+    this->plies = 0;
+}
+
+/**
+ * @brief Looks up the book move of a position.
+ *
+ * @param position The position. Its board must not be POSITION_ANY_BOARD.
+ * @param move Receives the move (board * 9 + cell).
+ * @return `false` if no book is open, the position is past the book or not in it.
+ */
+bool OpeningBook::probe(const Position &position, int &move) const
+{
+    if (!isOpen() || position.filled >= this->plies || !position.isRunning() || position.board == POSITION_ANY_BOARD)
+        return false;
+
+    int symmetry;
+    uint64_t key = getKey(position, symmetry);
+    const uint64_t *found = lower_bound(this->keys, this->keys + this->count, key);
+    if (found == this->keys + this->count || *found != key)
+        return false;
+
+    // Guards against a book built with other rules or a hash collision.
+    int mapped = Symmetry::move(Symmetry::inverse(symmetry), this->moves[found - this->keys]);
+    if (mapped / 9 != position.board || !(position.emptyCells(position.board) & (1 << mapped % 9)))
+        return false;
+
+    move = mapped;
+    return true;
+}
+
+#endif
@@ -0,0 +1,192 @@
+#ifndef POSITION_H
+#define POSITION_H
+
+#include "../../TicTacToe.h"
+#include "../../helpers/BitBoard.h"
+#include "../../struct/Coordinate.h"
+#include "./Zobrist.h"
+
+#include <cstdint>
+
+const int POSITION_NUM_BOARDS = 9;
+const int POSITION_NUM_MOVES = 81;
+const int POSITION_ANY_BOARD = 9; // The target board is full, the next board is drawn at random.
+const int POSITION_RUNNING = 0;
+const int POSITION_DRAW = 2;
+
+/**
+ * @brief A compact copy of the whole nine board game for the search engines.
+ *
+ * Each board is a pair of 9 bit masks, so copying a position is cheap and a move is a
+ * few bit operations. Moves are encoded as board * 9 + cell, with board and cell
+ * both row * 3 + col.
+ *
+ * The rules follow PlayerManager and BoardManager: a line on any board wins the game,
+ * the game is drawn once all 81 cells are taken, and the next board is the one the
+ * last move pointed to, or a random board that isn't full if that one is full.
+ *
+ * Once no line on any board can be completed the game can only end in a draw, however
+ * the remaining cells are filled. isDead() tells the playouts so they can stop there;
+ * the status stays POSITION_RUNNING, since the players still have to fill the grid.
+ */
+struct Position
+{
+    uint16_t masks[2][POSITION_NUM_BOARDS]; // [0] player 1, [1] player -1
+    uint16_t fullBoards;                    // Bit b is set when board b is full.
+    uint16_t deadBoards;                    // Bit b is set when no line on board b can still be completed.
+    uint64_t hash;
+    int8_t board;                           // Board to move on, or POSITION_ANY_BOARD.
+    int8_t toMove;                          // 1 or -1
+    int8_t status;                          // POSITION_RUNNING, the winner (1 or -1), or POSITION_DRAW
+    uint8_t filled;                         // Number of taken cells.
+
+    static Position fromGrid(TicTacToe (*grid)[3][3], const Coordinate *currentBoard, int toMove);
+
+    static int side(int player)
+    {
+        return player == 1 ? 0 : 1;
+    }
+
+    uint16_t emptyCells(int b) const
+    {
+        return (uint16_t)(~(this->masks[0][b] | this->masks[1][b]) & BITBOARD_FULL);
+    }
+
+    uint16_t openBoards() const
+    {
+        return (uint16_t)(~this->fullBoards & BITBOARD_FULL);
+    }
+
+    bool isRunning() const
+    {
+        return this->status == POSITION_RUNNING;
+    }
+
+    /**
+     * @brief Checks if the game is running but bound to be drawn, no board having a line left.
+     */
+    bool isDead() const
+    {
+        return this->deadBoards == BITBOARD_FULL;
+    }
+
+    void play(int b, int cell);
+    void setBoard(int b);
+    int legalMoves(uint8_t moves[POSITION_NUM_MOVES]) const;
+};
+
+/**
+ * @brief Copies the game into a position.
+ *
+ * @param grid A pointer to the nine board grid.
+ * @param currentBoard The board the next move is played on.
+ * @param toMove The player to move, 1 or -1.
+ */
+Position Position::fromGrid(TicTacToe (*grid)[3][3], const Coordinate *currentBoard, int toMove)
+{
+    Position position;
+    position.fullBoards = 0;
+    position.deadBoards = 0;
+    position.filled = 0;
+    position.status = POSITION_RUNNING;
+    position.toMove = (int8_t)toMove;
+    position.board = (int8_t)(currentBoard->x * 3 + currentBoard->y);
+    position.hash = Zobrist::hashGrid(grid) ^ Zobrist::board(position.board);
+
+    if (toMove != 1)
+        position.hash ^= Zobrist::side();
+
+    for (int b = 0; b < POSITION_NUM_BOARDS; b++)
+    {
+        TicTacToe *subBoard = &(*grid)[b / 3][b % 3];
+        position.masks[0][b] = subBoard->getMask(1);
+        position.masks[1][b] = subBoard->getMask(-1);
+
+        uint16_t taken = position.masks[0][b] | position.masks[1][b];
+        position.filled += BitBoard::popCount(taken);
+
+        if (taken == BITBOARD_FULL)
+            position.fullBoards |= (uint16_t)(1 << b);
+        if (BitBoard::isDead(position.masks[0][b], position.masks[1][b]))
+            position.deadBoards |= (uint16_t)(1 << b);
+        if (BitBoard::isWin(position.masks[0][b]))
+            position.status = 1;
+        else if (BitBoard::isWin(position.masks[1][b]))
+            position.status = -1;
+    }
+
+    if (position.status == POSITION_RUNNING && position.filled == POSITION_NUM_MOVES)
+        position.status = POSITION_DRAW;
+
+    return position;
+}
+
+/**
+ * @brief Plays a move for the player to move.
+ *
+ * When the move points to a full board the next board becomes POSITION_ANY_BOARD,
+ * and the caller picks the board with setBoard().
+ *
+ * @param b The board of the move. Must be the current board unless any board may be played.
+ * @param cell The cell of the move. Must be empty.
+ */
+void Position::play(int b, int cell)
+{
+    int s = side(this->toMove);
+    uint16_t bit = (uint16_t)(1 << cell);
+
+    this->masks[s][b] |= bit;
+    this->filled++;
+    this->hash ^= Zobrist::piece(this->toMove, b, cell) ^ Zobrist::board(this->board) ^ Zobrist::side();
+
+    if ((this->masks[0][b] | this->masks[1][b]) == BITBOARD_FULL)
+        this->fullBoards |= (uint16_t)(1 << b);
+    if (BitBoard::isDead(this->masks[0][b], this->masks[1][b]))
+        this->deadBoards |= (uint16_t)(1 << b);
+
+    if (BitBoard::isWin(this->masks[s][b]))
+        this->status = this->toMove;
+    else if (this->filled == POSITION_NUM_MOVES)
+        this->status = POSITION_DRAW;
+
+    this->board = (int8_t)((this->fullBoards & (1 << cell)) ? POSITION_ANY_BOARD : cell);
+    this->hash ^= Zobrist::board(this->board);
+    this->toMove = (int8_t)-this->toMove;
+}
+
+/**
+ * @brief Moves the game to another board, used to resolve a random redirect.
+ */
+void Position::setBoard(int b)
+{
+    this->hash ^= Zobrist::board(this->board) ^ Zobrist::board(b);
+    this->board = (int8_t)b;
+}
+
+/**
+ * @brief Lists the legal moves, ordered by board then cell.
+ *
+ * With POSITION_ANY_BOARD every empty cell is listed.
+ *
+ * @param moves Receives the moves (board * 9 + cell).
+ * @return The number of moves.
+ */
+int Position::legalMoves(uint8_t moves[POSITION_NUM_MOVES]) const
+{
+    int count = 0;
+    if (!isRunning())
+        return count;
+
+    int first = this->board == POSITION_ANY_BOARD ? 0 : this->board;
+    int last = this->board == POSITION_ANY_BOARD ? POSITION_NUM_BOARDS - 1 : this->board;
+
+    for (int b = first; b <= last; b++)
+    {
+        for (uint16_t empty = emptyCells(b); empty; empty &= empty - 1)
+            moves[count++] = (uint8_t)(b * 9 + BitBoard::lowestBit(empty));
+    }
+
+    return count;
+}
+
+#endif
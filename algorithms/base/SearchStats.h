@@ -0,0 +1,97 @@
+#ifndef SEARCHSTATS_H
+#define SEARCHSTATS_H
+
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+/**
+ * @brief Per-move search statistics shared by every algorithm.
+ *
+ * Each algorithm resets these at the start of useAlgorithm() and fills in whatever
+ * applies to it. Counters an algorithm doesn't use simply stay at 0.
+ */
+struct SearchStats
+{
+    long long nodes;            // Positions visited (search nodes or playout steps).
+    long long leafEvals;        // Positions scored without expanding further.
+    long long cutoffs;          // Alpha-beta cutoffs.
+    long long firstMoveCutoffs; // Cutoffs caused by the first move searched.
+    long long cacheHits;        // Transposition / lookup table hits, or tree nodes kept from the last move.
+    long long playouts;         // Completed random playouts.
+    int maxDepth;               // Deepest ply reached.
+    double elapsedMs;           // Wall-clock time of the move.
+
+    SearchStats()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        nodes = 0;
+        leafEvals = 0;
+        cutoffs = 0;
+        firstMoveCutoffs = 0;
+        cacheHits = 0;
+        playouts = 0;
+        maxDepth = 0;
+        elapsedMs = 0.0;
+    }
+
+    /**
+     * @brief Share of cutoffs produced by the first move tried. Close to 1 means good move ordering.
+     */
+    double firstMoveCutoffRate() const
+    {
+        return cutoffs > 0 ? (double)firstMoveCutoffs / cutoffs : 0.0;
+    }
+
+    /**
+     * @brief Effective branching factor, b* = nodes ^ (1 / maxDepth).
+     */
+    double effectiveBranchingFactor() const
+    {
+        return (maxDepth > 0 && nodes > 0) ? pow((double)nodes, 1.0 / maxDepth) : 0.0;
+    }
+
+    double playoutsPerSecond() const
+    {
+        return elapsedMs > 0.0 ? playouts * 1000.0 / elapsedMs : 0.0;
+    }
+
+    /**
+     * @brief Formats the statistics as a single line JSON record.
+     *
+     * @param engine The name of the algorithm.
+     * @param player The player the algorithm moved for (1 or -1).
+     * @param x The row of the chosen move.
+     * @param y The column of the chosen move.
+     */
+    string toJson(const string &engine, int player, int x, int y) const
+    {
+        ostringstream out;
+
+        out << "{\"engine\":\"" << engine << "\""
+            << ",\"player\":" << player
+            << ",\"move\":[" << x << "," << y << "]"
+            << ",\"nodes\":" << nodes
+            << ",\"leafEvals\":" << leafEvals
+            << ",\"cutoffs\":" << cutoffs
+            << ",\"firstMoveCutoffRate\":" << firstMoveCutoffRate()
+            << ",\"ebf\":" << effectiveBranchingFactor()
+            << ",\"maxDepth\":" << maxDepth
+            << ",\"cacheHits\":" << cacheHits
+            << ",\"playouts\":" << playouts
+            << ",\"playoutsPerSec\":" << playoutsPerSecond()
+            << ",\"elapsedMs\":" << elapsedMs
+            << "}";
+
+        return out.str();
+    }
+};
+
+#endif
@@ -0,0 +1,149 @@
+#ifndef SYMMETRY_H
+#define SYMMETRY_H
+
+#include "../../helpers/BitBoard.h"
+#include "./Position.h"
+#include "./Zobrist.h"
+
+#include <cstdint>
+
+const int SYMMETRY_COUNT = 8; // Rotations and reflections of a 3 x 3 square.
+const int SYMMETRY_IDENTITY = 0;
+
+/**
+ * @brief The cell permutations of the 8 symmetries, built once at startup.
+ *
+ * Symmetry s transposes when bit 2 is set, then flips the rows (bit 0) and the columns
+ * (bit 1).
+ */
+struct SymmetryTables
+{
+    uint8_t cells[SYMMETRY_COUNT][BITBOARD_NUM_CELLS];
+    uint8_t inverse[SYMMETRY_COUNT];
+
+    SymmetryTables()
+    {
+        for (int s = 0; s < SYMMETRY_COUNT; s++)
+        {
+            for (int cell = 0; cell < BITBOARD_NUM_CELLS; cell++)
+            {
+                int row = cell / 3, col = cell % 3;
+                if (s & 4)
+                {
+                    int swapped = row;
+                    row = col;
+                    col = swapped;
+                }
+                if (s & 1)
+                    row = 2 - row;
+                if (s & 2)
+                    col = 2 - col;
+
+                this->cells[s][cell] = (uint8_t)(row * 3 + col);
+            }
+        }
+
+        for (int s = 0; s < SYMMETRY_COUNT; s++)
+            for (int t = 0; t < SYMMETRY_COUNT; t++)
+                if (this->cells[t][this->cells[s][1]] == 1 && this->cells[t][this->cells[s][3]] == 3)
+                    this->inverse[s] = (uint8_t)t;
+    }
+};
+
+const SymmetryTables SYMMETRY_TABLES;
+
+/**
+ * @brief The symmetries of the nine board grid.
+ *
+ * The rules are the same under any rotation or reflection of the grid, as long as the
+ * boards and the cells inside every board are moved together: a move still points to
+ * the board in the same place as its cell.
+ */
+class Symmetry
+{
+public:
+    static int cell(int symmetry, int cell)
+    {
+        return SYMMETRY_TABLES.cells[symmetry][cell];
+    }
+
+    static int inverse(int symmetry)
+    {
+        return SYMMETRY_TABLES.inverse[symmetry];
+    }
+
+    /**
+     * @brief Maps a move (board * 9 + cell).
+     */
+    static int move(int symmetry, int move)
+    {
+        return cell(symmetry, move / 9) * 9 + cell(symmetry, move % 9);
+    }
+
+    static uint16_t mask(int symmetry, uint16_t mask);
+    static Position apply(int symmetry, const Position &position);
+    static uint64_t canonicalHash(const Position &position, int &symmetry);
+};
+
+/**
+ * @brief Maps the cells of a board mask.
+ */
+uint16_t Symmetry::mask(int symmetry, uint16_t mask)
+{
+    uint16_t mapped = 0;
+    for (; mask; mask &= mask - 1)
+        mapped |= (uint16_t)(1 << cell(symmetry, BitBoard::lowestBit(mask)));
+    return mapped;
+}
+
+/**
+ * @brief Maps a whole position, its hash included.
+ */
+Position Symmetry::apply(int symmetry, const Position &position)
+{
+    Position mapped = position;
+    mapped.fullBoards = mask(symmetry, position.fullBoards);
+    mapped.deadBoards = mask(symmetry, position.deadBoards);
+    mapped.board = (int8_t)(position.board == POSITION_ANY_BOARD ? POSITION_ANY_BOARD : cell(symmetry, position.board));
+    mapped.hash = Zobrist::board(mapped.board) ^ (position.toMove != 1 ? Zobrist::side() : 0);
+
+    for (int b = 0; b < POSITION_NUM_BOARDS; b++)
+    {
+        int to = cell(symmetry, b);
+        for (int s = 0; s < 2; s++)
+        {
+            mapped.masks[s][to] = mask(symmetry, position.masks[s][b]);
+            for (uint16_t pieces = mapped.masks[s][to]; pieces; pieces &= pieces - 1)
+                mapped.hash ^= Zobrist::piece(s == 0 ? 1 : -1, to, BitBoard::lowestBit(pieces));
+        }
+    }
+
+    return mapped;
+}
+
+/**
+ * @brief The hash shared by a position and its symmetric images, to store them under one key.
+ *
+ * @param position The position.
+ * @param symmetry Receives the symmetry that maps the position onto the one with that hash.
+ * @return The smallest hash over the symmetries.
+ */
+uint64_t Symmetry::canonicalHash(const Position &position, int &symmetry)
+{
+    uint64_t best = position.hash;
+    symmetry = SYMMETRY_IDENTITY;
+
+    for (int s = 1; s < SYMMETRY_COUNT; s++)
+    {
+        uint64_t hash = apply(s, position).hash;
+        if (hash < best)
+        {
+            best = hash;
+            symmetry = s;
+        }
+    }
+
+    return best;
+}
+
+#endif
@@ -0,0 +1,205 @@
+#ifndef THREATS_H
+#define THREATS_H
+
+#include "../../TicTacToe.h"
+#include "../../helpers/BitBoard.h"
+
+#include <cstdint>
+
+// Move classes returned by Threats::classifyMove(). A move can be several at once.
+const int THREAT_NONE = 0;
+const int THREAT_WINS = 1;       // Completes a line on the current board, winning the game.
+const int THREAT_BLOCKS = 2;     // Takes a cell the enemy would win with.
+const int THREAT_SENDS_LOSS = 4; // The enemy holds a winning cell on the board they are sent to.
+const int THREAT_REDIRECT = 8;   // The board the move points to is full, the enemy gets a random board.
+
+// Move ordering buckets, best first.
+const int THREAT_NUM_BUCKETS = 4;
+
+/**
+ * @brief Winning cells of every board, built once at startup.
+ *
+ * Indexed by BitBoard::ternaryIndex(own, enemy). A cell is winning for "own" when it is
+ * empty and completes a line with two of own's cells and none of the enemy's.
+ */
+struct ThreatTables
+{
+    uint16_t winningCells[BITBOARD_NUM_STATES];
+
+    ThreatTables()
+    {
+        for (int own = 0; own < BITBOARD_NUM_MASKS; own++)
+        {
+            for (int enemy = 0; enemy < BITBOARD_NUM_MASKS; enemy++)
+            {
+                if (own & enemy)
+                    continue;
+
+                uint16_t cells = 0;
+                for (int line = 0; line < BITBOARD_NUM_LINES; line++)
+                {
+                    uint16_t mask = BITBOARD_LINES[line];
+                    if (BitBoard::popCount(own & mask) == 2 && (enemy & mask) == 0)
+                        cells |= mask & ~own;
+                }
+
+                this->winningCells[BitBoard::ternaryIndex(own, enemy)] = cells;
+            }
+        }
+    }
+};
+
+const ThreatTables THREAT_TABLES;
+
+/**
+ * @brief Bitmask threat detection shared by the engines.
+ *
+ * Everything here is a handful of table lookups. No moves are made or undone.
+ */
+class Threats
+{
+public:
+    /**
+     * @brief Gets the cells that win the board for "own" straight away.
+     *
+     * @param own The cells held by the player.
+     * @param enemy The cells held by the enemy.
+     */
+    static uint16_t winningCells(uint16_t own, uint16_t enemy)
+    {
+        return THREAT_TABLES.winningCells[BitBoard::ternaryIndex(own, enemy)];
+    }
+
+    static int classifyMove(TicTacToe (*grid)[3][3], int board, int cell, int player);
+    static void classifyMoves(TicTacToe (*grid)[3][3], int board, int player, int threats[9]);
+    static int getBucket(int threats);
+};
+
+/**
+ * @brief Classifies a move on the nine board grid.
+ *
+ * @param grid A pointer to the nine board grid.
+ * @param board The board the move is played on (row * 3 + col).
+ * @param cell The cell of the move (row * 3 + col). Must be empty.
+ * @param player The player making the move, 1 or -1.
+ * @return A combination of the THREAT_* flags.
+ */
+int Threats::classifyMove(TicTacToe (*grid)[3][3], int board, int cell, int player)
+{
+    int enemyPlayer = -player;
+    TicTacToe *current = &(*grid)[board / 3][board % 3];
+    uint16_t own = current->getMask(player);
+    uint16_t enemy = current->getMask(enemyPlayer);
+    uint16_t bit = (uint16_t)(1 << cell);
+    int threats = THREAT_NONE;
+
+    if (winningCells(own, enemy) & bit)
+        threats |= THREAT_WINS;
+    if (winningCells(enemy, own) & bit)
+        threats |= THREAT_BLOCKS;
+
+    // Board the enemy is sent to. It gets the move too when it is the current board.
+    TicTacToe *target = &(*grid)[cell / 3][cell % 3];
+    uint16_t targetOwn = target->getMask(player) | (cell == board ? bit : 0);
+    uint16_t targetEnemy = target->getMask(enemyPlayer);
+
+    if ((targetOwn | targetEnemy) != BITBOARD_FULL)
+    {
+        if (winningCells(targetEnemy, targetOwn))
+            threats |= THREAT_SENDS_LOSS;
+
+        return threats;
+    }
+
+    // The target is full, so the enemy may end up on any board that isn't.
+    threats |= THREAT_REDIRECT;
+    for (int other = 0; other < 9; other++)
+    {
+        TicTacToe *redirect = &(*grid)[other / 3][other % 3];
+        uint16_t otherOwn = redirect->getMask(player) | (other == board ? bit : 0);
+        uint16_t otherEnemy = redirect->getMask(enemyPlayer);
+
+        if ((otherOwn | otherEnemy) != BITBOARD_FULL && winningCells(otherEnemy, otherOwn))
+        {
+            threats |= THREAT_SENDS_LOSS;
+            break;
+        }
+    }
+
+    return threats;
+}
+
+/**
+ * @brief Classifies every empty cell of a board at once.
+ *
+ * Same result as classifyMove() for each cell, but the masks of the current board are
+ * only read once.
+ *
+ * @param grid A pointer to the nine board grid.
+ * @param board The board to move on (row * 3 + col).
+ * @param player The player making the move, 1 or -1.
+ * @param threats Receives the THREAT_* flags of each empty cell. Taken cells are left untouched.
+ */
+void Threats::classifyMoves(TicTacToe (*grid)[3][3], int board, int player, int threats[9])
+{
+    int enemyPlayer = -player;
+    TicTacToe *current = &(*grid)[board / 3][board % 3];
+    uint16_t own = current->getMask(player);
+    uint16_t enemy = current->getMask(enemyPlayer);
+    uint16_t wins = winningCells(own, enemy);
+    uint16_t blocks = winningCells(enemy, own);
+    uint16_t empty = ~(own | enemy) & BITBOARD_FULL;
+
+    while (empty)
+    {
+        int cell = BitBoard::lowestBit(empty);
+        uint16_t bit = (uint16_t)(1 << cell);
+        empty &= empty - 1;
+
+        int flags = THREAT_NONE;
+        if (wins & bit)
+            flags |= THREAT_WINS;
+        if (blocks & bit)
+            flags |= THREAT_BLOCKS;
+
+        if (cell == board)
+        {
+            // The enemy stays on this board.
+            if ((own | bit | enemy) == BITBOARD_FULL)
+                flags = classifyMove(grid, board, cell, player);
+            else if (winningCells(enemy, own | bit))
+                flags |= THREAT_SENDS_LOSS;
+        }
+        else
+        {
+            TicTacToe *target = &(*grid)[cell / 3][cell % 3];
+            uint16_t targetOwn = target->getMask(player);
+            uint16_t targetEnemy = target->getMask(enemyPlayer);
+
+            if ((targetOwn | targetEnemy) == BITBOARD_FULL)
+                flags = classifyMove(grid, board, cell, player);
+            else if (winningCells(targetEnemy, targetOwn))
+                flags |= THREAT_SENDS_LOSS;
+        }
+
+        threats[cell] = flags;
+    }
+}
+
+/**
+ * @brief Move ordering bucket of a classified move.
+ *
+ * 0 = wins, 1 = blocks, 2 = quiet, 3 = hands the enemy a win.
+ */
+int Threats::getBucket(int threats)
+{
+    if (threats & THREAT_WINS)
+        return 0;
+    if (threats & THREAT_BLOCKS)
+        return 1;
+    if (threats & THREAT_SENDS_LOSS)
+        return 3;
+    return 2;
+}
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include "../../TicTacToe.h"
+#include "../../helpers/Random.h"
+
+#include <cstdint>
+
+const int ZOBRIST_NUM_CELLS = 9 * 9;
+const int ZOBRIST_NUM_BOARDS = 10; // 9 boards + "any board" (random redirect).
+
+/**
+ * @brief Zobrist keys for hashing nine board positions.
+ *
+ * A position hash is the XOR of one key per occupied cell, plus the key of the board
+ * the next move is played on and the side key when player -1 is to move. Keys are
+ * generated with splitmix64 from a fixed seed, so hashes are stable between runs and
+ * can be stored in files.
+ */
+class Zobrist
+{
+private:
+    uint64_t pieceKeys[2][ZOBRIST_NUM_CELLS];
+    uint64_t boardKeys[ZOBRIST_NUM_BOARDS];
+    uint64_t sideKey;
+
+    Zobrist();
+    static const Zobrist &keys();
+
+public:
+    static uint64_t piece(int player, int board, int cell);
+    static uint64_t board(int board);
+    static uint64_t side();
+    static uint64_t hashGrid(TicTacToe (*grid)[3][3]);
+};
+
+Zobrist::Zobrist()
+{
+    uint64_t state = 0x4e42546963546163ULL; // "NBTicTac"
+
+    for (int player = 0; player < 2; player++)
+        for (int cell = 0; cell < ZOBRIST_NUM_CELLS; cell++)
+            this->pieceKeys[player][cell] = Random::splitMix64(state);
+
+    for (int board = 0; board < ZOBRIST_NUM_BOARDS; board++)
+        this->boardKeys[board] = Random::splitMix64(state);
+
+    this->sideKey = Random::splitMix64(state);
+}
+
+const Zobrist &Zobrist::keys()
+{
+    static const Zobrist instance;
+    return instance;
+}
+
+/**
+ * @brief Key of a piece on the nine board grid.
+ *
+ * @param player The player, 1 or -1.
+ * @param board The board index (row * 3 + col), 0-8.
+ * @param cell The cell index inside the board (row * 3 + col), 0-8.
+ */
+uint64_t Zobrist::piece(int player, int board, int cell)
+{
+    return keys().pieceKeys[player == 1 ? 0 : 1][board * 9 + cell];
+}
+
+/**
+ * @brief Key of the board the next move must be played on. 9 means any board.
+ */
+uint64_t Zobrist::board(int board)
+{
+    return keys().boardKeys[board];
+}
+
+/**
+ * @brief Key XORed in when player -1 is to move.
+ */
+uint64_t Zobrist::side()
+{
+    return keys().sideKey;
+}
+
+/**
+ * @brief Hashes the pieces on the grid. Board and side keys are left to the caller.
+ *
+ * @param grid A pointer to the nine board grid.
+ */
+uint64_t Zobrist::hashGrid(TicTacToe (*grid)[3][3])
+{
+    uint64_t hash = 0;
+
+    for (int board = 0; board < 9; board++)
+    {
+        TicTacToe *subBoard = &(*grid)[board / 3][board % 3];
+
+        for (int cell = 0; cell < 9; cell++)
+        {
+            int value = subBoard->getCell(cell / 3, cell % 3);
+            if (value != 0)
+                hash ^= piece(value, board, cell);
+        }
+    }
+
+    return hash;
+}
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef HEURISTIC_TABLE_H
+#define HEURISTIC_TABLE_H
+
+#include "../../../helpers/BitBoard.h"
+
+#include <cstdint>
+
+const int HEURISTIC_MOVE_WEIGHT = 1;
+const int HEURISTIC_WIN_WEIGHT = 10;
+const int HEURISTIC_INIAL_SCORE = 10;
+const int HEURISTIC_NUM_POSITIONS = 4;
+
+// Cells in the order the heuristic prefers them. Centre > Corners > Cross
+const int HEURISTIC_CENTRE = 4;
+const int HEURISTIC_CORNERS[HEURISTIC_NUM_POSITIONS] = {0, 2, 6, 8};
+const int HEURISTIC_CROSS[HEURISTIC_NUM_POSITIONS] = {1, 3, 5, 7};
+
+/**
+ * @brief The ranked candidate moves of one board.
+ *
+ * @param count The number of empty cells.
+ * @param cells The empty cells (row * 3 + col), best first.
+ * @param scores The static score of each cell, before the next board is weighed.
+ */
+struct HeuristicEntry
+{
+    uint8_t count;
+    uint8_t cells[BITBOARD_NUM_CELLS];
+    int8_t scores[BITBOARD_NUM_CELLS];
+};
+
+/**
+ * @brief The centre > corners > cross heuristic precomputed for every board.
+ *
+ * Indexed by the (own, enemy) masks of the board. Every empty cell starts at
+ * HEURISTIC_INIAL_SCORE, and corners and cross cells that complete a line for
+ * the player get HEURISTIC_WIN_WEIGHT on top. The centre is taken as is. Ties keep
+ * the centre > corners > cross order.
+ */
+class HeuristicTable
+{
+private:
+    HeuristicEntry entries[BITBOARD_NUM_STATES];
+
+    HeuristicTable();
+    void addCandidate(HeuristicEntry &entry, const int cell, const int score);
+
+public:
+    static const HeuristicEntry &lookup(uint16_t own, uint16_t enemy);
+};
+
+HeuristicTable::HeuristicTable()
+{
+    for (int own = 0; own < BITBOARD_NUM_MASKS; own++)
+    {
+        for (int enemy = 0; enemy < BITBOARD_NUM_MASKS; enemy++)
+        {
+            if (own & enemy)
+                continue;
+
+            HeuristicEntry &entry = this->entries[BitBoard::ternaryIndex(own, enemy)];
+            uint16_t empty = ~(own | enemy) & BITBOARD_FULL;
+            entry.count = 0;
+
+            // CENTRE
+            if (empty & (1 << HEURISTIC_CENTRE))
+                addCandidate(entry, HEURISTIC_CENTRE, HEURISTIC_INIAL_SCORE);
+
+            // CORNERS, then CROSS
+            for (int group = 0; group < 2; group++)
+            {
+                const int *cells = group == 0 ? HEURISTIC_CORNERS : HEURISTIC_CROSS;
+
+                for (int i = 0; i < HEURISTIC_NUM_POSITIONS; i++)
+                {
+                    uint16_t bit = (uint16_t)(1 << cells[i]);
+                    if (!(empty & bit))
+                        continue;
+
+                    // We weight the score by the win status
+                    int score = HEURISTIC_INIAL_SCORE;
+                    if (BitBoard::isWin(own | bit))
+                        score += HEURISTIC_WIN_WEIGHT;
+
+                    addCandidate(entry, cells[i], score);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Inserts a cell into the ranked candidates, after every cell with the same or a higher score.
+ */
+void HeuristicTable::addCandidate(HeuristicEntry &entry, const int cell, const int score)
+{
+    int position = entry.count;
+    while (position > 0 && entry.scores[position - 1] < score)
+    {
+        entry.cells[position] = entry.cells[position - 1];
+        entry.scores[position] = entry.scores[position - 1];
+        position--;
+    }
+
+    entry.cells[position] = (uint8_t)cell;
+    entry.scores[position] = (int8_t)score;
+    entry.count++;
+}
+
+/**
+ * @brief Gets the ranked candidate moves of a board.
+ *
+ * @param own The cells held by the player to move.
+ * @param enemy The cells held by the enemy.
+ */
+const HeuristicEntry &HeuristicTable::lookup(uint16_t own, uint16_t enemy)
+{
+    static const HeuristicTable table;
+    return table.entries[BitBoard::ternaryIndex(own, enemy)];
+}
+
+#endif
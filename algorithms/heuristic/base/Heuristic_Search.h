@@ -1,13 +1,10 @@
 #ifndef HEURISTIC_SEARCH_H
 #define HEURISTIC_SEARCH_H
 
+#include "../../../helpers/BitBoard.h"
 #include "../../../helpers/Tools.h"
 #include "../../base/Algorithm.h"
-
-const int HEURISTIC_MOVE_WEIGHT = 1;
-const int HEURISTIC_WIN_WEIGHT = 10;
-const int HEURISTIC_INIAL_SCORE = 10;
-const int HEURISTIC_NUM_POSITIONS = 4;
+#include "./HeuristicTable.h"
 
 class HeuristicSearch : public Algorithm
 {
@@ -20,10 +17,7 @@ protected:
 
     // PROTECTED METHODS
     void resetPositions();
-    void checkCentre(TicTacToe *board);
-    void checkCorners(TicTacToe *board);
-    void checkCross(TicTacToe *board);
-    void simulateMove(TicTacToe *board, int arr[HEURISTIC_NUM_POSITIONS][2], int &currScore);
+    void selectMove(TicTacToe *board);
     void evaluateScore(const int currScore, const int x, const int y);
     void weighScore(TicTacToe *nextBoard, int &currScore) const;
 
@@ -69,6 +63,11 @@ void HeuristicSearch::resetPositions()
  */
 void HeuristicSearch::evaluateScore(const int currScore, const int x, const int y)
 {
+    // Every candidate is a single ply leaf.
+    this->stats.nodes++;
+    this->stats.leafEvals++;
+    this->stats.maxDepth = 1;
+
     if (currScore > this->bestScore)
     {
         this->bestScore = currScore;
@@ -78,113 +77,39 @@ void HeuristicSearch::evaluateScore(const int currScore, const int x, const int
 }
 
 /**
- * @brief Checks if the centre is available and prioritize it
+ * @brief Picks the best move on the board
+ *
+ * The ranked candidates come straight from the heuristic table. Only the weighing
+ * by enemy moves on the next board is done per move.
  *
- * @param board A pointer to the board
+ * @param board A pointer to the current board.
  */
-void HeuristicSearch::checkCentre(TicTacToe *board)
+void HeuristicSearch::selectMove(TicTacToe *board)
 {
-    int currScore = HEURISTIC_INIAL_SCORE;
-
-    // Initialise initial coordinates for centre.
-    const int centreX = 1, centreY = 1;
+    const HeuristicEntry &entry = HeuristicTable::lookup(board->getMask(this->player), board->getMask(this->enemyPlayer));
+    this->stats.cacheHits++;
 
-    // Check if the centre is available and prioritize it
-    if (board->getCell(centreX, centreY) == BOARD_EMPTY)
+    for (int i = 0; i < entry.count; i++)
     {
+        // Candidates are sorted by their static score and weighing only lowers
+        // the score, so the rest can't beat the best move anymore.
+        if (entry.scores[i] <= this->bestScore)
+            break;
+
+        int posX = entry.cells[i] / BOARD_SIZE;
+        int posY = entry.cells[i] % BOARD_SIZE;
+        int currScore = entry.scores[i];
+
+        // Depending if the caller wants to weigh by enemy moves, this statement
+        // will be ran.
         if (this->weighByEnemyMoves)
         {
-            TicTacToe *nextBoard = &(*grid)[centreX][centreY];
-
+            // Check the number of enemy moves on the next board.
+            TicTacToe *nextBoard = &(*grid)[posX][posY];
             weighScore(nextBoard, currScore);
         }
 
-        evaluateScore(currScore, centreX, centreY);
-    }
-}
-
-/**
- * @brief Checks if the cross is available and prioritize it
- *
- * @param board A pointer to the board
- */
-void HeuristicSearch::checkCross(TicTacToe *board)
-{
-    int currScore = HEURISTIC_INIAL_SCORE;
-
-    // Initialise the coordinates for cross position.
-    int cross[HEURISTIC_NUM_POSITIONS][2] = {{0, 1}, {1, 0}, {1, 2}, {2, 1}};
-
-    // Evaluate cross and prioritize the best one
-    simulateMove(board, cross, currScore);
-}
-
-/**
- * @brief Checks if the corners are available and prioritize them
- *
- * @param board A pointer to the board
- */
-void HeuristicSearch::checkCorners(TicTacToe *board)
-{
-    int currScore = HEURISTIC_INIAL_SCORE;
-
-    // Initialise coordinates for corners.
-    int corners[HEURISTIC_NUM_POSITIONS][2] = {{0, 0}, {0, 2}, {2, 0}, {2, 2}};
-
-    // Evaluate corners and prioritize the best one
-    simulateMove(board, corners, currScore);
-}
-
-/**
- * @brief Generates all possible next move
- *
- * This methods explores all possible next moves and evaluates their score
- * so the algorithm can decide which move is the best.
- *
- * @param board A pointer to the current board.
- * @param arr An array of 4 coordinates. Type int[4][2].
- * @param currScore A reference to the current score.
- */
-void HeuristicSearch::simulateMove(TicTacToe *board, int arr[HEURISTIC_NUM_POSITIONS][2], int &currScore)
-{
-    // Evaluate corners and prioritize the best one
-    for (int i = 0; i < HEURISTIC_NUM_POSITIONS; i++)
-    {
-        // Get the coordinates
-        int posX = arr[i][0];
-        int posY = arr[i][1];
-
-        if (board->getCell(posX, posY) == BOARD_EMPTY)
-        {
-            // Simulate the corner move
-            board->addMove(posX, posY, this->player);
-
-            // Evaluate the score of the simulated move
-            int status = board->gameStatus();
-
-            // We weight the score by the win status
-            if (status == this->player)
-                currScore += HEURISTIC_WIN_WEIGHT;
-            else if (status == this->enemyPlayer)
-                currScore -= HEURISTIC_WIN_WEIGHT;
-
-            // Depending if the caller wants to weigh by enemy moves, this statement
-            // will be ran.
-            if (this->weighByEnemyMoves)
-            {
-                // Check the number of enemy moves on the next board.
-                TicTacToe *nextBoard = &(*grid)[posX][posY];
-                weighScore(nextBoard, currScore);
-            }
-
-            // Undo the move
-            board->addMove(posX, posY, BOARD_EMPTY);
-
-            evaluateScore(currScore, posX, posY);
-
-            // Reset score
-            currScore = HEURISTIC_INIAL_SCORE;
-        }
+        evaluateScore(currScore, posX, posY);
     }
 }
 
@@ -197,7 +122,7 @@ void HeuristicSearch::simulateMove(TicTacToe *board, int arr[HEURISTIC_NUM_POSIT
 void HeuristicSearch::weighScore(TicTacToe *nextBoard, int &currScore) const
 {
     // Check the number of enemy moves on the next board.
-    int noOfPlayerMovesNextBoard = Tools::checkValues(nextBoard, this->enemyPlayer);
+    int noOfPlayerMovesNextBoard = BitBoard::popCount(nextBoard->getMask(this->enemyPlayer));
 
     // We weight the score by the number of enemy moves.
     currScore -= noOfPlayerMovesNextBoard * HEURISTIC_MOVE_WEIGHT;
@@ -15,6 +15,7 @@ public:
     }
 
     void useAlgorithm(int *x, int *y, const Coordinate *currentBoard) override;
+    string getName() const override;
 };
 
 /**
@@ -29,6 +30,8 @@ public:
  */
 void MindfulAlgorithm::useAlgorithm(int *x, int *y, const Coordinate *currentBoard)
 {
+    beginSearch();
+
     // Initially reset the positions first
     resetPositions();
 
@@ -39,10 +42,8 @@ void MindfulAlgorithm::useAlgorithm(int *x, int *y, const Coordinate *currentBoa
     // The move will be randomly selected.
     if (!Tools::isBoardEmpty(board))
     {
-        // SIMULATE ALL MOVES
-        checkCentre(board);
-        checkCorners(board);
-        checkCross(board);
+        // EVALUATE ALL MOVES
+        selectMove(board);
     }
     else
     {
@@ -53,6 +54,13 @@ void MindfulAlgorithm::useAlgorithm(int *x, int *y, const Coordinate *currentBoa
     // ASSIGN THE BEST MOVE TO THE X AND Y POINTERS
     *x = this->bestX;
     *y = this->bestY;
+
+    endSearch(this->bestX, this->bestY);
+}
+
+string MindfulAlgorithm::getName() const
+{
+    return "Mindful";
 }
 
 #endif
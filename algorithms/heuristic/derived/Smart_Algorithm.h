@@ -14,6 +14,7 @@ public:
     }
 
     void useAlgorithm(int *x, int *y, const Coordinate *currentBoard) override;
+    string getName() const override;
 };
 
 /**
@@ -28,20 +29,27 @@ public:
  */
 void SmartAlgorithm::useAlgorithm(int *x, int *y, const Coordinate *currentBoard)
 {
+    beginSearch();
+
     // Initially reset the positions first
     resetPositions();
 
     // Get the current board
     TicTacToe *board = &(*this->grid)[currentBoard->x][currentBoard->y];
 
-    // SIMULATE ALL MOVES
-    checkCentre(board);
-    checkCorners(board);
-    checkCross(board);
+    // EVALUATE ALL MOVES
+    selectMove(board);
 
     // ASSIGN THE BEST MOVE TO THE X AND Y POINTERS
     *x = this->bestX;
     *y = this->bestY;
+
+    endSearch(this->bestX, this->bestY);
+}
+
+string SmartAlgorithm::getName() const
+{
+    return "Smart";
 }
 
 #endif
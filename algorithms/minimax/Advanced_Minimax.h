@@ -4,10 +4,19 @@
 #include "../../TicTacToe.h"
 #include "../base/Algorithm.h"
 #include "../../struct/Coordinate.h"
+#include "../base/Threats.h"
+#include "../base/Zobrist.h"
+#include "../../helpers/BitBoard.h"
+#include "./ProofNumberSearch.h"
+#include "./SearchTrace.h"
+#include "./Tablebase.h"
+#include "./ThreatSpaceSearch.h"
+#include "./TranspositionTable.h"
+#include <cmath>
 #include <limits>
 
 // CONSTANTS
-const int ADVANCED_MINIMAX_WIN_WEIGHT = 20;
+const int ADVANCED_MINIMAX_WIN_WEIGHT = 100;
 const int ADVANCED_MINIMAX_DRAW_WEIGHT = 0;
 const int MAX_PLAYER = -1;
 const int MIN_PLAYER = 1;
@@ -16,6 +25,13 @@ const int MIN_PLAYER = 1;
 // There's about 81! possible moves, and calculating that is realistically unfeasible.
 const int DEFAULT_DEPTH_LIMIT = 7;
 const int ADVANCED_MINIMAX_MAX_DEPTH_LIMIT = 12;
+const int ADVANCED_MINIMAX_NUM_KILLERS = 2;       // Quiet moves that caused a cutoff, kept per ply.
+const int ADVANCED_MINIMAX_NO_KILLER = -1;
+const int ADVANCED_MINIMAX_TABLE_MIN_PLIES = 3;   // Plies left below a node for it to use the transposition table.
+// Wins found by the search score at least this and losses at most minus this, at any depth
+// it can reach. Other scores stay within the pieces on a board.
+const int ADVANCED_MINIMAX_WIN_BOUND = ADVANCED_MINIMAX_WIN_WEIGHT / 2;
+const uint64_t ADVANCED_MINIMAX_PROOF_NODES = 200000; // Proof search nodes per move with --dfpn, about 0.15 s.
 
 using namespace std;
 
@@ -26,14 +42,43 @@ private:
     static int minimaxCalls;
     int depthLimit;
 
+    // SEARCH STATE
+    // Kept from one move to the next, the previous search orders and cuts the next one.
+    uint64_t hash; // Zobrist hash of the pieces on the grid.
+    int rootPly;   // Moves on the grid at the root of the current search, -1 before the first.
+    long long rootScores; // Scores returned that count plies from the root, see minimax().
+    TranspositionTable table;
+    int killers[ADVANCED_MINIMAX_MAX_DEPTH_LIMIT + 1][ADVANCED_MINIMAX_NUM_KILLERS]; // board * 9 + cell
+
+    // PROOF SEARCH
+    // Searches for a forced win run before the alpha-beta search: the threat-space search
+    // always, the df-pn search unless it has 0 nodes.
+    ThreatSpaceSearch threatSearch;
+    uint64_t proofNodes;
+    ProofNumberSearch prover;
+
+    // SEARCH TRACE (only with -DNBTTT_SEARCH_TRACE)
+    TRACE_STATE(int traceRootMove;)
+
     // PRIVATE METHODS
     int minimax(TicTacToe *prevBoard, TicTacToe *currBoard, bool isMaximising, int depth, int alpha, int beta);
     bool isTerminalState(TicTacToe *prevBoard, TicTacToe *currBoard, int depth, int &score);
-    void simulateMove(TicTacToe *currBoard, bool isMaximising, int depth, int alpha, int beta, int &bestScore);
+    bool probeTablebase(TicTacToe *currBoard, bool isMaximising, int depth, int &score);
+    bool playProvenWin(int *x, int *y, const Coordinate *currentBoard);
+    void simulateMove(TicTacToe *currBoard, bool isMaximising, int depth, int &alpha, int &beta, int &bestScore, int hashMove, int &bestMove);
+    int orderMoves(TicTacToe *board, int currPlayer, int depth, int hashMove, int moves[]);
+    void prepareTables(int ply);
+    void recordCutoff(TicTacToe *board, int depth, int cell);
+    int toTableScore(int score, int depth) const;
+    int fromTableScore(int score, int depth) const;
     int getTotalMoves();
+    int getBoardIndex(TicTacToe *board) const;
+    TRACE_STATE(void traceNode(TicTacToe *prevBoard, TicTacToe *currBoard, int depth, int alphaIn, int betaIn, int alpha, int beta, int score, uint8_t flags);)
 
 public:
     void useAlgorithm(int *x, int *y, const Coordinate *currentBoard);
+    string getName() const override;
+    void setProofNodes(uint64_t maxNodes) override;
 
     /**
      * @brief Constructor
@@ -46,8 +91,13 @@ public:
      */
     Advanced_Minimax(TicTacToe (*grid)[3][3], int player, int depthLimit = DEFAULT_DEPTH_LIMIT)
         : Algorithm(grid, player),
-          depthLimit(depthLimit)
+          depthLimit(depthLimit),
+          hash(0),
+          rootPly(-1),
+          rootScores(0),
+          proofNodes(0)
     {
+        prepareTables(0);
     }
 };
 
@@ -63,6 +113,22 @@ int Advanced_Minimax::minimaxCalls = 0;
  */
 void Advanced_Minimax::useAlgorithm(int *x, int *y, const Coordinate *currentBoard)
 {
+    beginSearch();
+
+    // Opening moves come from the book when one is open.
+    if (playBookMove(x, y, currentBoard))
+    {
+        endSearch(*x, *y);
+        return;
+    }
+
+    // A forced win found by the threat-space or proof search needs no further search.
+    if (playProvenWin(x, y, currentBoard))
+    {
+        endSearch(*x, *y);
+        return;
+    }
+
     // Update how many times this function has been called.
     this->minimaxCalls++;
 
@@ -88,6 +154,8 @@ void Advanced_Minimax::useAlgorithm(int *x, int *y, const Coordinate *currentBoa
 
     // Starting board
     TicTacToe *board = &(*grid)[currentBoard->x][currentBoard->y];
+    this->hash = Zobrist::hashGrid(this->grid);
+    prepareTables(getTotalMoves());
 
     // Root nodes
     for (int row = 0; row < BOARD_SIZE; row++)
@@ -101,6 +169,9 @@ void Advanced_Minimax::useAlgorithm(int *x, int *y, const Coordinate *currentBoa
                 // Get the next board.
                 TicTacToe *nextBoard = &(*this->grid)[row][col];
 
+                this->hash ^= Zobrist::piece(this->player, getBoardIndex(board), row * BOARD_SIZE + col);
+                TRACE(this->traceRootMove = getBoardIndex(board) * 9 + row * BOARD_SIZE + col);
+
                 // Determine if player is maximising or minimising.
                 bool isMaximising = (this->player == MAX_PLAYER ? false : true);
 
@@ -114,6 +185,7 @@ void Advanced_Minimax::useAlgorithm(int *x, int *y, const Coordinate *currentBoa
 
                 // Undo the move
                 board->addMove(row, col, BOARD_EMPTY);
+                this->hash ^= Zobrist::piece(this->player, getBoardIndex(board), row * BOARD_SIZE + col);
 
                 // Depending on the kind of player is our Minimax algorith (1 or -1)
                 // The best move is the one that maximises or minimises the score.
@@ -144,6 +216,64 @@ void Advanced_Minimax::useAlgorithm(int *x, int *y, const Coordinate *currentBoa
     // Assign the best move to our pointer variables.
     *x = bestX;
     *y = bestY;
+
+    endSearch(bestX, bestY);
+}
+
+string Advanced_Minimax::getName() const
+{
+    return "Advanced Minimax";
+}
+
+/**
+ * @brief Lets a proof number search look for a forced win before every alpha-beta search.
+ *
+ * Unlike the alpha-beta search, it has no depth limit and follows the redirects, so it
+ * finds long forced sequences on one board. It stops after maxNodes nodes when it can
+ * neither prove nor disprove the win.
+ *
+ * @param maxNodes The most nodes per move, 0 to turn it off.
+ */
+void Advanced_Minimax::setProofNodes(uint64_t maxNodes)
+{
+    this->proofNodes = maxNodes;
+}
+
+/**
+ * @brief Looks for a forced win at the root and takes its first move if there is one.
+ *
+ * The threat-space search runs first: it only follows forcing sends, takes a millisecond
+ * or so and finds most wins of that kind far beyond the depth limit. The proof search,
+ * when turned on, then looks for any other forced win.
+ *
+ * @param x Receives the row of the winning move.
+ * @param y Receives the column of the winning move.
+ * @param currentBoard The board the move must be played on.
+ * @return `true` if a win was proven.
+ */
+bool Advanced_Minimax::playProvenWin(int *x, int *y, const Coordinate *currentBoard)
+{
+    Position position = Position::fromGrid(this->grid, currentBoard, this->player);
+    int move = -1;
+
+    bool won = this->threatSearch.findWin(position, move);
+    this->stats.nodes += (long long)this->threatSearch.getNodes();
+
+    if (!won && this->proofNodes > 0)
+    {
+        ProofResult result = this->prover.solve(position, this->proofNodes);
+        this->stats.nodes += (long long)result.nodes;
+
+        won = result.status == PNS_PROVEN && result.move >= 0;
+        move = result.move;
+    }
+
+    if (!won)
+        return false;
+
+    *x = move % 9 / BOARD_SIZE;
+    *y = move % 9 % BOARD_SIZE;
+    return true;
 }
 
 /**
@@ -153,6 +283,11 @@ void Advanced_Minimax::useAlgorithm(int *x, int *y, const Coordinate *currentBoa
  * by recursively exploring all possible states up to a specified depth limit (defined by ADVANCED_MINIMAX_DEPTH_LIMIT). Alpha and beta values are used for pruning, to eliminate
  * branches that do not need to be explored as they cannot influence the outcome of the game.
  *
+ * Searched positions go into the transposition table. A position reached again, in this
+ * search or a later one, takes its score from the table when it was searched at least as
+ * deep and the stored bound decides the window, and otherwise searches the stored best
+ * move first.
+ *
  * @param prevBoard A pointer to the previous TicTacToe board.
  * @param currBoard A pointer to the current TicTacToe board being evaluated.
  * @param isMaximising A boolean indicating whether the current move is for the maximizing player.
@@ -161,29 +296,99 @@ void Advanced_Minimax::useAlgorithm(int *x, int *y, const Coordinate *currentBoa
  */
 int Advanced_Minimax::minimax(TicTacToe *prevBoard, TicTacToe *currBoard, bool isMaximising, int depth, int alpha, int beta)
 {
+    // Root moves are played at ply 1, so this node sits at ply depth + 1.
+    this->stats.nodes++;
+    this->stats.maxDepth = std::max(this->stats.maxDepth, depth + 1);
+
     // TERMINAL STATE
     // --------------
+    // Window the node was entered with.
+    TRACE_STATE(const int alphaIn = alpha;)
+    TRACE_STATE(const int betaIn = beta;)
+
     int score = 0;
+
+    // TABLEBASE
+    // ---------
+    // Late positions have an exact value when a tablebase is open, however deep they are.
+    if (probeTablebase(currBoard, isMaximising, depth, score))
+    {
+        this->stats.cacheHits++;
+        this->rootScores++;
+        TRACE(traceNode(prevBoard, currBoard, depth, alphaIn, betaIn, alpha, beta, score, TRACE_FLAG_TABLEBASE));
+        return score;
+    }
+
     if (isTerminalState(prevBoard, currBoard, depth, score))
     {
+        this->stats.leafEvals++;
+        TRACE(traceNode(prevBoard, currBoard, depth, alphaIn, betaIn, alpha, beta, score, TRACE_FLAG_LEAF));
         return score;
     }
 
+    // TRANSPOSITION TABLE
+    // -------------------
+    // Only nodes with a few plies under them are worth a lookup, the rest are cheaper to search.
+    // Entries of earlier searches cut too, their scores count plies from the position. Those
+    // are searched 2 plies shallower than needed, but a forced win or loss holds at any depth.
+    int draft = this->depthLimit - depth;
+    bool useTable = draft >= ADVANCED_MINIMAX_TABLE_MIN_PLIES;
+    uint64_t key = 0;
+    int hashMove = TRANSPOSITION_NO_MOVE;
+
+    if (useTable)
+    {
+        key = this->hash ^ Zobrist::board(getBoardIndex(currBoard)) ^ (isMaximising ? Zobrist::side() : 0);
+        const TranspositionEntry *entry = this->table.probe(key);
+
+        if (entry)
+            hashMove = entry->bestMove;
+
+        if (entry && (!entry->rootOnly || entry->rootPly == this->rootPly))
+        {
+            int entryScore = entry->rootOnly ? entry->score : fromTableScore(entry->score, depth);
+            bool deepEnough = entry->draft >= draft;
+            bool won = !entry->rootOnly && entry->bound != TRANSPOSITION_UPPER && entry->score >= ADVANCED_MINIMAX_WIN_BOUND;
+            bool lost = !entry->rootOnly && entry->bound != TRANSPOSITION_LOWER && entry->score <= -ADVANCED_MINIMAX_WIN_BOUND;
+            if ((deepEnough && entry->bound == TRANSPOSITION_EXACT) ||
+                ((deepEnough || won) && entry->bound != TRANSPOSITION_UPPER && entryScore >= beta) ||
+                ((deepEnough || lost) && entry->bound != TRANSPOSITION_LOWER && entryScore <= alpha))
+            {
+                this->stats.cacheHits++;
+                this->rootScores += entry->rootOnly;
+                TRACE(traceNode(prevBoard, currBoard, depth, alphaIn, betaIn, alpha, beta, entryScore, TRACE_FLAG_TABLE));
+                return entryScore;
+            }
+        }
+    }
+
     // SIMULATE MOVES
     // --------------
     // Simulate all possible moves and evaluate them.
-    if (isMaximising)
-    {
-        int bestScore = NEGATIVE_INFINITY;
-        simulateMove(currBoard, isMaximising, depth, alpha, beta, bestScore);
-        return bestScore;
-    }
-    else
+    const int alphaStart = alpha;
+    const int betaStart = beta;
+    const long long rootScoresStart = this->rootScores;
+    int bestScore = isMaximising ? NEGATIVE_INFINITY : POSITIVE_INFINITY;
+    int bestMove = TRANSPOSITION_NO_MOVE;
+
+    simulateMove(currBoard, isMaximising, depth, alpha, beta, bestScore, hashMove, bestMove);
+    TRACE(traceNode(prevBoard, currBoard, depth, alphaIn, betaIn, alpha, beta, bestScore, beta <= alpha ? TRACE_FLAG_CUTOFF : 0));
+
+    // A board with no empty cell has no score to store.
+    if (useTable && bestMove != TRANSPOSITION_NO_MOVE)
     {
-        int bestScore = POSITIVE_INFINITY;
-        simulateMove(currBoard, isMaximising, depth, alpha, beta, bestScore);
-        return bestScore;
+        uint8_t bound = TRANSPOSITION_EXACT;
+        if (bestScore <= alphaStart)
+            bound = TRANSPOSITION_UPPER;
+        else if (bestScore >= betaStart)
+            bound = TRANSPOSITION_LOWER;
+
+        // A tablebase score below the node can't be made relative, it keeps the root's plies.
+        bool rootOnly = this->rootScores != rootScoresStart;
+        this->table.store(key, rootOnly ? bestScore : toTableScore(bestScore, depth), bound, bestMove, this->rootPly, draft, rootOnly);
     }
+
+    return bestScore;
 }
 
 /**
@@ -244,6 +449,42 @@ bool Advanced_Minimax::isTerminalState(TicTacToe *prevBoard, TicTacToe *currBoar
     return false;
 }
 
+/**
+ * @brief Looks the position up in the endgame tablebase.
+ *
+ * The tablebase gives the expected result for the player to move, from -1 to 1, with
+ * the random redirects averaged in. It is scaled to the weight of a win at this depth,
+ * so a known win scores like a win found by the search and earlier wins still score higher.
+ * Positions that are already won are left to isTerminalState().
+ *
+ * @param currBoard A pointer to the board to move on.
+ * @param isMaximising A boolean indicating whether the player to move is the maximizing player.
+ * @param depth The current depth of the recursive search tree.
+ * @param score Receives the score if the position is in the tablebase.
+ * @return `true` if the position is in the tablebase.
+ */
+bool Advanced_Minimax::probeTablebase(TicTacToe *currBoard, bool isMaximising, int depth, int &score)
+{
+    const Tablebase &tablebase = Tablebase::instance();
+    if (!tablebase.isOpen() || BOARD_FULL - getTotalMoves() > tablebase.getMaxEmpties())
+        return false;
+
+    int currPlayer = isMaximising ? MAX_PLAYER : MIN_PLAYER;
+    uint16_t own[POSITION_NUM_BOARDS], enemy[POSITION_NUM_BOARDS];
+    for (int b = 0; b < POSITION_NUM_BOARDS; b++)
+    {
+        own[b] = (*this->grid)[b / 3][b % 3].getMask(currPlayer);
+        enemy[b] = (*this->grid)[b / 3][b % 3].getMask(-currPlayer);
+    }
+
+    double value;
+    if (!tablebase.probe(own, enemy, getBoardIndex(currBoard), value))
+        return false;
+
+    score = (int)lround((isMaximising ? value : -value) * (ADVANCED_MINIMAX_WIN_WEIGHT - depth));
+    return true;
+}
+
 /**
  * @brief Move simulator/generator for the minimax algorithm.
  *
@@ -252,51 +493,232 @@ bool Advanced_Minimax::isTerminalState(TicTacToe *prevBoard, TicTacToe *currBoar
  * @param currBoard A pointer to the current board.
  * @param isMaximising A boolean indicating whether the current move is for the maximizing player.
  * @param depth The current depth of the recursive tree, used to limit search depth.
+ * @param alpha A reference to the alpha value of the node, updated as moves are searched.
+ * @param beta A reference to the beta value of the node, updated as moves are searched.
  * @param bestScore A reference to the current best score.
- * @return An integer representing the evaluated score of the current board state.
+ * @param hashMove The best cell of this position in the transposition table, searched first.
+ * @param bestMove Receives the cell that scored best.
  */
-void Advanced_Minimax::simulateMove(TicTacToe *currBoard, bool isMaximising, int depth, int alpha, int beta, int &bestScore)
+void Advanced_Minimax::simulateMove(TicTacToe *currBoard, bool isMaximising, int depth, int &alpha, int &beta, int &bestScore, int hashMove, int &bestMove)
 {
+    // Determine player.
+    int currPlayer = isMaximising ? MAX_PLAYER : MIN_PLAYER;
+
+    // Search winning moves and blocks first, they produce most of the cutoffs.
+    // Just above the depth limit every child is a leaf, so plain row by row order is cheaper.
+    int moves[BOARD_SIZE * BOARD_SIZE];
+    int numMoves = 0;
+    if (depth + 1 < this->depthLimit)
+    {
+        numMoves = orderMoves(currBoard, currPlayer, depth, hashMove, moves);
+    }
+    else
+    {
+        for (uint16_t empty = currBoard->getEmptyMask(); empty; empty &= empty - 1)
+            moves[numMoves++] = BitBoard::lowestBit(empty);
+    }
+
+    // Children near the depth limit don't use the table, so moves into them needn't
+    // keep the hash. Those are most of the moves of the search.
+    bool hashed = this->depthLimit - (depth + 1) >= ADVANCED_MINIMAX_TABLE_MIN_PLIES;
+    TRACE(hashed = true);
+
     // Simulate all possible moves
-    for (int row = 0; row < BOARD_SIZE; row++)
+    for (int i = 0; i < numMoves; i++)
     {
-        for (int col = 0; col < BOARD_SIZE; col++)
+        int row = moves[i] / BOARD_SIZE;
+        int col = moves[i] % BOARD_SIZE;
+
+        // Start move simulation.
+        currBoard->addMove(row, col, currPlayer);
+        if (hashed)
+            this->hash ^= Zobrist::piece(currPlayer, getBoardIndex(currBoard), row * BOARD_SIZE + col);
+
+        TicTacToe *nextBoard = &(*this->grid)[row][col];
+
+        // Go to the next player and pass the next board.
+        int score = minimax(currBoard, nextBoard, !isMaximising, depth + 1, alpha, beta);
+
+        // Undo the move. VERY IMPORTANT!
+        currBoard->addMove(row, col, BOARD_EMPTY);
+        if (hashed)
+            this->hash ^= Zobrist::piece(currPlayer, getBoardIndex(currBoard), row * BOARD_SIZE + col);
+
+        // Update best score and perform the pruning
+        if (bestMove == TRANSPOSITION_NO_MOVE || (isMaximising ? score > bestScore : score < bestScore))
+            bestMove = moves[i];
+
+        if (isMaximising)
         {
-            // We can only simulate to positions that are empty.
-            if (currBoard->getCell(row, col) == BOARD_EMPTY)
-            {
-                // Determine player and start move simulation.
-                int currPlayer = isMaximising ? MAX_PLAYER : MIN_PLAYER;
-                currBoard->addMove(row, col, currPlayer);
+            bestScore = std::max(bestScore, score);
+            alpha = std::max(alpha, score);
+        }
+        else
+        {
+            bestScore = std::min(bestScore, score);
+            beta = std::min(beta, score);
+        }
 
-                TicTacToe *nextBoard = &(*this->grid)[row][col];
+        // Pruning branches
+        if (beta <= alpha)
+        {
+            this->stats.cutoffs++;
+            if (i == 0)
+                this->stats.firstMoveCutoffs++;
 
-                // Go to the next player and pass the next board.
-                int score = minimax(currBoard, nextBoard, !isMaximising, depth + 1, alpha, beta);
+            recordCutoff(currBoard, depth, moves[i]);
+            return;
+        }
+    }
+}
 
-                // Undo the move. VERY IMPORTANT!
-                currBoard->addMove(row, col, BOARD_EMPTY);
+/**
+ * @brief Orders the empty cells of a board for the search.
+ *
+ * The transposition table's best move goes first. The rest are classified with the
+ * threat tables: wins first, then blocks, then quiet moves, and moves that send the
+ * enemy to a board they can win on last. Inside each group the killer moves of this
+ * ply come first, then the others row by row.
+ *
+ * @param board A pointer to the board to move on.
+ * @param currPlayer The player to move.
+ * @param depth The ply of the board below the root.
+ * @param hashMove The cell to search first, or TRANSPOSITION_NO_MOVE.
+ * @param moves Receives the cells (row * 3 + col) in search order.
+ * @return The number of moves.
+ */
+int Advanced_Minimax::orderMoves(TicTacToe *board, int currPlayer, int depth, int hashMove, int moves[])
+{
+    int buckets[THREAT_NUM_BUCKETS][BOARD_SIZE * BOARD_SIZE];
+    int bucketSizes[THREAT_NUM_BUCKETS] = {0, 0, 0, 0};
+    int threats[BOARD_SIZE * BOARD_SIZE];
+    int boardIndex = getBoardIndex(board);
+    uint16_t empty = board->getEmptyMask();
 
-                // Update best score and perform the pruning
-                if (isMaximising)
-                {
-                    bestScore = std::max(bestScore, score);
-                    alpha = std::max(alpha, score);
-                }
-                else
-                {
-                    bestScore = std::min(bestScore, score);
-                    beta = std::min(beta, score);
-                }
+    Threats::classifyMoves(this->grid, boardIndex, currPlayer, threats);
 
-                // Pruning branches
-                if (beta <= alpha)
-                {
-                    return;
-                }
+    int numMoves = 0;
+    if (hashMove != TRANSPOSITION_NO_MOVE && (empty & (1 << hashMove)))
+    {
+        moves[numMoves++] = hashMove;
+        empty &= ~(1 << hashMove);
+    }
+
+    // Killers are stored as board * 9 + cell, keep the ones on this board.
+    uint16_t killerCells = 0;
+    for (int k = 0; k < ADVANCED_MINIMAX_NUM_KILLERS && depth <= ADVANCED_MINIMAX_MAX_DEPTH_LIMIT; k++)
+        if (this->killers[depth][k] != ADVANCED_MINIMAX_NO_KILLER && this->killers[depth][k] / 9 == boardIndex)
+            killerCells |= 1 << (this->killers[depth][k] % 9);
+
+    while (empty)
+    {
+        int cell = BitBoard::lowestBit(empty);
+        empty &= empty - 1;
+
+        int bucket = Threats::getBucket(threats[cell]);
+        buckets[bucket][bucketSizes[bucket]++] = cell;
+    }
+
+    for (int bucket = 0; bucket < THREAT_NUM_BUCKETS; bucket++)
+    {
+        uint16_t killed = 0;
+        for (int i = 0; i < bucketSizes[bucket]; i++)
+        {
+            if (killerCells & (1 << buckets[bucket][i]))
+            {
+                moves[numMoves++] = buckets[bucket][i];
+                killed |= 1 << buckets[bucket][i];
             }
         }
+
+        for (int i = 0; i < bucketSizes[bucket]; i++)
+            if (!(killed & (1 << buckets[bucket][i])))
+                moves[numMoves++] = buckets[bucket][i];
     }
+
+    return numMoves;
+}
+
+/**
+ * @brief Remembers a move that caused a cutoff as a killer move of its ply.
+ *
+ * @param board A pointer to the board the move was played on.
+ * @param depth The ply of the board below the root.
+ * @param cell The cell (row * 3 + col).
+ */
+void Advanced_Minimax::recordCutoff(TicTacToe *board, int depth, int cell)
+{
+    int move = getBoardIndex(board) * 9 + cell;
+
+    if (depth > ADVANCED_MINIMAX_MAX_DEPTH_LIMIT)
+        return;
+
+    int *plyKillers = this->killers[depth];
+    if (plyKillers[0] != move)
+    {
+        plyKillers[1] = plyKillers[0];
+        plyKillers[0] = move;
+    }
+}
+
+/**
+ * @brief Carries the killer moves over to a new search.
+ *
+ * Every move played since the last search brings each ply one closer to the root, so the
+ * killers move up one ply per move, two between the engine's own turns. A new game (fewer
+ * moves on the grid) starts them afresh. The transposition table is kept as it is, its
+ * scores don't depend on the root.
+ *
+ * @param ply The number of moves on the grid at the new root.
+ */
+void Advanced_Minimax::prepareTables(int ply)
+{
+    int shift = this->rootPly < 0 ? -1 : ply - this->rootPly;
+    this->rootPly = ply;
+
+    for (int depth = 0; depth <= ADVANCED_MINIMAX_MAX_DEPTH_LIMIT; depth++)
+    {
+        for (int k = 0; k < ADVANCED_MINIMAX_NUM_KILLERS; k++)
+        {
+            if (shift >= 0 && depth + shift <= ADVANCED_MINIMAX_MAX_DEPTH_LIMIT)
+                this->killers[depth][k] = this->killers[depth + shift][k];
+            else
+                this->killers[depth][k] = ADVANCED_MINIMAX_NO_KILLER;
+        }
+    }
+}
+
+/**
+ * @brief Turns a score of a node into one that holds under any root, for the transposition table.
+ *
+ * Wins and losses are weighed by the ply they happen at, counted from the root. Stored,
+ * they are counted from the node instead. Other scores don't depend on the ply.
+ *
+ * @param score The score, counting plies from the root.
+ * @param depth The depth of the node below the root.
+ */
+int Advanced_Minimax::toTableScore(int score, int depth) const
+{
+    if (score >= ADVANCED_MINIMAX_WIN_BOUND)
+        return score + depth;
+    if (score <= -ADVANCED_MINIMAX_WIN_BOUND)
+        return score - depth;
+    return score;
+}
+
+/**
+ * @brief Turns a score from the transposition table back into one counting plies from the root.
+ *
+ * @param score The stored score, counting plies from the node.
+ * @param depth The depth of the node below the current root.
+ */
+int Advanced_Minimax::fromTableScore(int score, int depth) const
+{
+    if (score >= ADVANCED_MINIMAX_WIN_BOUND)
+        return score - depth;
+    if (score <= -ADVANCED_MINIMAX_WIN_BOUND)
+        return score + depth;
+    return score;
 }
 
 /**
@@ -323,4 +745,40 @@ int Advanced_Minimax::getTotalMoves()
     return totalMoves;
 }
 
+/**
+ * @brief Gets the index (row * 3 + col) of a board inside the nineboard grid.
+ */
+int Advanced_Minimax::getBoardIndex(TicTacToe *board) const
+{
+    return (int)(board - &(*this->grid)[0][0]);
+}
+
+#ifdef NBTTT_SEARCH_TRACE
+/**
+ * @brief Writes a node to the search trace if it passes the trace limits.
+ */
+void Advanced_Minimax::traceNode(TicTacToe *prevBoard, TicTacToe *currBoard, int depth, int alphaIn, int betaIn, int alpha, int beta, int score, uint8_t flags)
+{
+    SearchTrace &trace = SearchTrace::instance();
+    uint64_t hash = this->hash ^ Zobrist::board(getBoardIndex(currBoard));
+
+    if (!trace.shouldRecord(hash, depth + 1))
+        return;
+
+    TraceRecord record;
+    record.hash = hash;
+    record.alphaIn = alphaIn;
+    record.betaIn = betaIn;
+    record.alphaOut = alpha;
+    record.betaOut = beta;
+    record.score = score;
+    record.depth = (uint8_t)(depth + 1);
+    record.move = (uint8_t)(getBoardIndex(prevBoard) * 9 + getBoardIndex(currBoard));
+    record.rootMove = (uint8_t)this->traceRootMove;
+    record.flags = flags;
+
+    trace.record(record);
+}
+#endif
+
 #endif
\ No newline at end of file
@@ -2,9 +2,11 @@
 #define MINIMAX_H
 
 #include "../../TicTacToe.h"
+#include "../../helpers/BitBoard.h"
 #include "../../helpers/Tools.h"
 #include "../../struct/Coordinate.h"
 #include "../base/Algorithm.h"
+#include "./PerfectPlayTable.h"
 #include <limits>
 #include <cstdlib>
 #include <ctime>
@@ -17,12 +19,12 @@ class Minimax : public Algorithm
 {
 private:
     // PRIVATE METHODS
-    int minimax(TicTacToe *board, TicTacToe *nextBoard, const bool isMaximising, const int depth);
-    bool isTerminalState(TicTacToe *board, TicTacToe *nextBoard, const int depth, int &score);
-    void simulateMove(TicTacToe *board, const bool isMaximising, const int depth, int &bestScore);
+    int evaluateMove(TicTacToe *board, const int row, const int col);
+    int getTerminalScore(const int winner, const int depth, const int noEnemyOccurrences) const;
 
 public:
     void useAlgorithm(int *x, int *y, const Coordinate *currentBoard);
+    string getName() const override;
 
     /**
      * @brief Constructor
@@ -31,9 +33,11 @@ public:
      * It's simply just a minimax algorithm. This algorithm
      * won't be effective as it thinks to win a single tictactoe game. To prevent from choosing
      * the same first move every time. I gave the this algorithm the ability to check the next board
-     * so it can weigh the score of move it'll choose, effectively making it a good model for 
+     * so it can weigh the score of move it'll choose, effectively making it a good model for
      * nine board tictactoe.
      *
+     * The single board search itself is precomputed, see PerfectPlayTable.
+     *
      * @param grid A pointer to the nineboard tictactoe. Type TicTacToe (*grid)[3][3].
      * @param player The player. Either 1 or -1
      */
@@ -54,6 +58,8 @@ public:
  */
 void Minimax::useAlgorithm(int *x, int *y, const Coordinate *currentBoard)
 {
+    beginSearch();
+
     int bestScore = (this->player == MINIMAX_MAX_PLAYER ? NEGATIVE_INFINITY : POSITIVE_INFINITY);
     int bestX = -1, bestY = -1;
 
@@ -63,7 +69,7 @@ void Minimax::useAlgorithm(int *x, int *y, const Coordinate *currentBoard)
     // Only simulate if the board is not empty
     if (!Tools::isBoardEmpty(board))
     {
-        // Simulate all possible moves from the current state of the board
+        // Evaluate all possible moves from the current state of the board
         for (int row = 0; row < BOARD_SIZE; row++)
         {
             for (int col = 0; col < BOARD_SIZE; col++)
@@ -71,21 +77,7 @@ void Minimax::useAlgorithm(int *x, int *y, const Coordinate *currentBoard)
                 // Check if the cell is empty
                 if (board->getCell(row, col) == BOARD_EMPTY)
                 {
-                    // SIMULATING EACH MOVE
-                    // We set the cell to player value = computer.
-                    board->addMove(row, col, this->player);
-
-                    // Determine if player is maximising or minimising.
-                    bool isMaximising = (this->player == MINIMAX_MAX_PLAYER ? false : true);
-
-                    // Check next board
-                    TicTacToe *nextBoard = &(*this->grid)[row][col];
-
-                    // Go to the next node (next player).
-                    int score = minimax(board, nextBoard, isMaximising, 0);
-
-                    // Undo move
-                    board->addMove(row, col, BOARD_EMPTY);
+                    int score = evaluateMove(board, row, col);
 
                     // MAXIMISING
                     if (this->player == MINIMAX_MAX_PLAYER)
@@ -121,121 +113,81 @@ void Minimax::useAlgorithm(int *x, int *y, const Coordinate *currentBoard)
     // Set the best move
     *x = bestX;
     *y = bestY;
+
+    endSearch(bestX, bestY);
 }
 
-/**
- * @brief The minimax algorithm
- *
- * @param board The game board
- * @param depth The depth of the search, also equal to number of moves
- * @param isMaximising Whether it is the computer's turn or not
- * @return The score of the best move
- */
-int Minimax::minimax(TicTacToe *board, TicTacToe *nextBoard, const bool isMaximising, const int depth)
+string Minimax::getName() const
 {
-    int score = 0;
-    if (isTerminalState(board, nextBoard, depth, score))
-    {
-        return score;
-    }
-
-    if (isMaximising)
-    {
-        // We set the initial best score for maximizing player to the lowest possible score. In this case -infinity.
-        int bestScore = NEGATIVE_INFINITY;
-
-        // Simulate all possible moves, or generate moves.
-        simulateMove(board, isMaximising, depth, bestScore);
-        return bestScore;
-    }
-    else
-    {
-        // We set the initial best score for minimizing player to the highest possible score. In this case +infinity.
-        int bestScore = POSITIVE_INFINITY;
-
-        // Simulate all possible moves
-        simulateMove(board, isMaximising, depth, bestScore);
-        return bestScore;
-    }
+    return "Minimax";
 }
 
 /**
- * @brief Checks if the game is over
+ * @brief Scores a move with perfect play on the current board
  *
- * TERMINAL STATE
- * Return the score depending on the depth (no of moves)
- * Maximizing player: Better score the closer to 10
- * Minimizing player: Better score the closer to -10
+ * The outcome of the board after the move comes from the perfect play table,
+ * then it is weighed by the number of enemy moves on the board the move sends
+ * the enemy to.
  *
- * @param board The game board
- * @param depth The depth of the search
- * @param score The score of the game
- * @return `true` if the game is over or
- * @return `false` if the game is not over
+ * @param board The current board
+ * @param row The row of the move
+ * @param col The column of the move
+ * @return The score of the move. Higher is better for the maximising player.
  */
-bool Minimax::isTerminalState(TicTacToe *board, TicTacToe *nextBoard, const int depth, int &score)
+int Minimax::evaluateMove(TicTacToe *board, const int row, const int col)
 {
-    // Check game status
-    int status = board->gameStatus();
+    uint16_t bit = BitBoard::cellBit(row, col);
+    uint16_t playerOne = board->getMask(PLAYER_ONE);
+    uint16_t playerTwo = board->getMask(PLAYER_TWO);
+
+    if (this->player == PLAYER_ONE)
+        playerOne |= bit;
+    else
+        playerTwo |= bit;
+
+    // Look up the board after the move, with the enemy to move.
+    const PerfectPlayEntry &entry = PerfectPlayTable::lookup(playerOne, playerTwo, this->enemyPlayer);
+    this->stats.nodes++;
+    this->stats.cacheHits++;
+    this->stats.maxDepth = 1;
 
     // Count number of enemy occurrences on the next board.
-    int noEnemyOccurrences = Tools::checkValues(nextBoard, this->enemyPlayer);
+    int noEnemyOccurrences = Tools::checkValues(&(*this->grid)[row][col], this->enemyPlayer);
 
-    // Check each terminal state
-    if (status == MINIMAX_MIN_PLAYER) // Minimising player has won
-    {
-        score = -MINIMAX_PLAYER_WIN_WEIGHT + depth + noEnemyOccurrences;
-        return true;
-    }
-    else if (status == MINIMAX_MAX_PLAYER) // Maximising player has won
-    {
-        score = MINIMAX_PLAYER_WIN_WEIGHT - (depth + noEnemyOccurrences);
-        return true;
-    }
-    else if (status == GAME_DRAW) // Draw
-    {
-        score = 0 - noEnemyOccurrences;
-        return true;
-    }
+    // The table holds the outcome for the enemy, who is to move.
+    int winner = GAME_DRAW;
+    if (entry.value == PERFECT_PLAY_WIN)
+        winner = this->enemyPlayer;
+    else if (entry.value == PERFECT_PLAY_LOSS)
+        winner = this->player;
 
-    return false; // Game is not over
+    return getTerminalScore(winner, entry.plies, noEnemyOccurrences);
 }
 
 /**
- * @brief Simulates all possible moves
+ * @brief Scores the outcome of the board
  *
- * @param isMaximising Whether it is the computer's turn or not
- * @param board The game board
- * @param bestScore The best score
- * @param depth The depth of the search
+ * TERMINAL STATE
+ * Return the score depending on the depth (no of moves)
+ * Maximizing player: Better score the closer to 20
+ * Minimizing player: Better score the closer to -20
+ * Sending the enemy to a board they already hold cells on makes the score worse for the player.
+ *
+ * @param winner The winner of the board, or GAME_DRAW
+ * @param depth The number of moves after this move until the board is decided
+ * @param noEnemyOccurrences The number of enemy moves on the next board
+ * @return The score of the move
  */
-void Minimax::simulateMove(TicTacToe *board, const bool isMaximising, const int depth, int &bestScore)
+int Minimax::getTerminalScore(const int winner, const int depth, const int noEnemyOccurrences) const
 {
-    // Simulate all possible moves
-    for (int row = 0; row < BOARD_SIZE; row++)
-    {
-        for (int col = 0; col < BOARD_SIZE; col++)
-        {
-            // Check if the cell is empty on the current selected board
-            if (board->getCell(row, col) == BOARD_EMPTY)
-            {
-                // Set the cell value to the current player
-                board->addMove(row, col, isMaximising ? -1 : 1);
+    if (winner == MINIMAX_MIN_PLAYER) // Minimising player wins
+        return -MINIMAX_PLAYER_WIN_WEIGHT + depth + noEnemyOccurrences;
 
-                // Check next board
-                TicTacToe *nextBoard = &(*this->grid)[row][col];
+    if (winner == MINIMAX_MAX_PLAYER) // Maximising player wins
+        return MINIMAX_PLAYER_WIN_WEIGHT - (depth + noEnemyOccurrences);
 
-                // Simulate the next move for the next player
-                int score = minimax(board, nextBoard, depth + 1, !isMaximising);
-
-                // Undo for the next branch
-                board->addMove(row, col, BOARD_EMPTY);
-
-                // Evaluate the best score
-                bestScore = isMaximising ? std::max(bestScore, score) : std::min(bestScore, score);
-            }
-        }
-    }
+    // Draw
+    return this->player == MINIMAX_MAX_PLAYER ? -noEnemyOccurrences : noEnemyOccurrences;
 }
 
 #endif
@@ -0,0 +1,150 @@
+#ifndef PERFECT_PLAY_TABLE_H
+#define PERFECT_PLAY_TABLE_H
+
+#include "../../helpers/BitBoard.h"
+
+#include <cstdint>
+
+const int8_t PERFECT_PLAY_WIN = 1;
+const int8_t PERFECT_PLAY_DRAW = 0;
+const int8_t PERFECT_PLAY_LOSS = -1;
+const int8_t PERFECT_PLAY_UNSOLVED = -2;
+
+/**
+ * @brief The solved value of a single 3 x 3 board.
+ *
+ * @param value Outcome for the side to move: PERFECT_PLAY_WIN, PERFECT_PLAY_DRAW or PERFECT_PLAY_LOSS.
+ * @param plies Number of plies until the board is decided. Winners take the quickest line, losers the longest.
+ * @param bestCell The cell (row * 3 + col) to play, or -1 if the board is already decided.
+ */
+struct PerfectPlayEntry
+{
+    int8_t value;
+    int8_t plies;
+    int8_t bestCell;
+};
+
+/**
+ * @brief Every single board position solved exhaustively.
+ *
+ * The table holds 3^9 = 19,683 positions for each side to move, indexed by
+ * BitBoard::ternaryIndex(). It is built the first time it is used and the
+ * lookups are O(1) afterwards.
+ */
+class PerfectPlayTable
+{
+private:
+    PerfectPlayEntry entries[2][BITBOARD_NUM_STATES];
+
+    PerfectPlayTable();
+    const PerfectPlayEntry &solve(uint16_t playerOne, uint16_t playerTwo, int side);
+
+public:
+    static const PerfectPlayEntry &lookup(uint16_t playerOne, uint16_t playerTwo, int player);
+};
+
+PerfectPlayTable::PerfectPlayTable()
+{
+    for (int side = 0; side < 2; side++)
+        for (int index = 0; index < BITBOARD_NUM_STATES; index++)
+            this->entries[side][index].value = PERFECT_PLAY_UNSOLVED;
+
+    // Solve every combination of masks that don't overlap.
+    for (int playerOne = 0; playerOne < BITBOARD_NUM_MASKS; playerOne++)
+    {
+        for (int playerTwo = 0; playerTwo < BITBOARD_NUM_MASKS; playerTwo++)
+        {
+            if ((playerOne & playerTwo) == 0)
+            {
+                solve(playerOne, playerTwo, 0);
+                solve(playerOne, playerTwo, 1);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Solves a position with memoised negamax.
+ *
+ * @param side 0 if player 1 is to move, 1 if player -1 is to move.
+ */
+const PerfectPlayEntry &PerfectPlayTable::solve(uint16_t playerOne, uint16_t playerTwo, int side)
+{
+    PerfectPlayEntry &entry = this->entries[side][BitBoard::ternaryIndex(playerOne, playerTwo)];
+    if (entry.value != PERFECT_PLAY_UNSOLVED)
+        return entry;
+
+    uint16_t own = side == 0 ? playerOne : playerTwo;
+    uint16_t enemy = side == 0 ? playerTwo : playerOne;
+    uint16_t empty = ~(playerOne | playerTwo) & BITBOARD_FULL;
+
+    entry.plies = 0;
+    entry.bestCell = -1;
+
+    // TERMINAL STATES
+    if (BitBoard::isWin(enemy))
+    {
+        entry.value = PERFECT_PLAY_LOSS;
+        return entry;
+    }
+    if (BitBoard::isWin(own))
+    {
+        entry.value = PERFECT_PLAY_WIN;
+        return entry;
+    }
+    if (empty == 0)
+    {
+        entry.value = PERFECT_PLAY_DRAW;
+        return entry;
+    }
+
+    // Try every move. The value of a move is the negated value of the reply.
+    int8_t bestValue = PERFECT_PLAY_UNSOLVED;
+    int8_t bestPlies = 0;
+    int8_t bestCell = -1;
+
+    for (int cell = 0; cell < BITBOARD_NUM_CELLS; cell++)
+    {
+        uint16_t bit = (uint16_t)(1 << cell);
+        if (!(empty & bit))
+            continue;
+
+        const PerfectPlayEntry &reply = side == 0 ? solve(playerOne | bit, playerTwo, 1)
+                                                  : solve(playerOne, playerTwo | bit, 0);
+        int8_t value = (int8_t)-reply.value;
+        int8_t plies = (int8_t)(reply.plies + 1);
+
+        // Prefer the better outcome. With equal outcomes, win quickly and lose slowly.
+        bool better = value > bestValue ||
+                      (value == bestValue && value == PERFECT_PLAY_WIN && plies < bestPlies) ||
+                      (value == bestValue && value != PERFECT_PLAY_WIN && plies > bestPlies);
+
+        if (better)
+        {
+            bestValue = value;
+            bestPlies = plies;
+            bestCell = (int8_t)cell;
+        }
+    }
+
+    entry.value = bestValue;
+    entry.plies = bestPlies;
+    entry.bestCell = bestCell;
+
+    return entry;
+}
+
+/**
+ * @brief Looks up a solved board.
+ *
+ * @param playerOne The mask of player 1.
+ * @param playerTwo The mask of player -1.
+ * @param player The player to move, 1 or -1.
+ */
+const PerfectPlayEntry &PerfectPlayTable::lookup(uint16_t playerOne, uint16_t playerTwo, int player)
+{
+    static const PerfectPlayTable table;
+    return table.entries[player == 1 ? 0 : 1][BitBoard::ternaryIndex(playerOne, playerTwo)];
+}
+
+#endif
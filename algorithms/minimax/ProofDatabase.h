@@ -0,0 +1,149 @@
+#ifndef PROOF_DATABASE_H
+#define PROOF_DATABASE_H
+
+#include "../../helpers/MappedFile.h"
+#include "../base/Position.h"
+#include "../base/Symmetry.h"
+
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+// Proof database: the positions the full game solver has settled, with which side can
+// force a win from them.
+//
+// tools/GameSolver.cpp builds the file and ProofNumberSearch reads it through a memory
+// mapping, see ProofDatabase.
+
+const uint32_t PROOF_DATABASE_MAGIC = 0x4450424e; // "NBPD"
+const uint32_t PROOF_DATABASE_VERSION = 1;
+
+// Flags of a position, for the player to move. Unset flags are unknown.
+const uint8_t PROOF_DATABASE_WIN = 1;     // It can force a win.
+const uint8_t PROOF_DATABASE_NO_WIN = 2;  // It can't: the opponent or a redirect holds it to a draw or better.
+const uint8_t PROOF_DATABASE_LOSS = 4;    // The opponent can force a win.
+const uint8_t PROOF_DATABASE_NO_LOSS = 8; // The opponent can't.
+
+/**
+ * @brief File header of a proof database.
+ *
+ * It is followed by `count` sorted keys (uint64_t) and then `count` flags (uint8_t), the
+ * flags of key i at index i.
+ */
+struct ProofDatabaseHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t keySize;
+    uint32_t flagSize;
+    uint32_t maxPieces; // No stored position has more pieces than this.
+    uint32_t reserved;
+    uint64_t count;
+};
+
+static_assert(sizeof(ProofDatabaseHeader) == 32, "ProofDatabaseHeader must stay 32 bytes");
+
+/**
+ * @brief Read only access to a proof database file.
+ *
+ * Positions are keyed by Symmetry::canonicalHash(), so one entry covers all 8 images of
+ * a position, and the flags need no mapping back. There is a single process wide
+ * database, opened by the application.
+ */
+class ProofDatabase
+{
+private:
+    MappedFile file;
+    const uint64_t *keys;
+    const uint8_t *flags;
+    uint64_t count;
+    int maxPieces;
+
+    ProofDatabase() : keys(nullptr), flags(nullptr), count(0), maxPieces(0) {}
+
+public:
+    static ProofDatabase &instance();
+
+    bool open(const char *path);
+    void close();
+    uint8_t probe(const Position &position) const;
+
+    bool isOpen() const
+    {
+        return this->keys != nullptr;
+    }
+
+    int getMaxPieces() const
+    {
+        return this->maxPieces;
+    }
+};
+
+ProofDatabase &ProofDatabase::instance()
+{
+    static ProofDatabase database;
+    return database;
+}
+
+/**
+ * @brief Maps a proof database file and checks its header.
+ *
+ * @param path The file written by tools/GameSolver.cpp.
+ * @return `true` if the file is a proof database of this version.
+ */
+bool ProofDatabase::open(const char *path)
+{
+    close();
+
+    if (!this->file.open(path))
+        return false;
+
+    const ProofDatabaseHeader *header = (const ProofDatabaseHeader *)this->file.getData();
+    if (this->file.getSize() < sizeof(ProofDatabaseHeader) || header->magic != PROOF_DATABASE_MAGIC ||
+        header->version != PROOF_DATABASE_VERSION || header->keySize != sizeof(uint64_t) ||
+        header->flagSize != sizeof(uint8_t) ||
+        this->file.getSize() != sizeof(ProofDatabaseHeader) + header->count * (sizeof(uint64_t) + sizeof(uint8_t)))
+    {
+        this->file.close();
+        return false;
+    }
+
+    this->count = header->count;
+    this->maxPieces = (int)header->maxPieces;
+    this->keys = (const uint64_t *)(this->file.getData() + sizeof(ProofDatabaseHeader));
+    this->flags = (const uint8_t *)(this->keys + this->count);
+
+    return true;
+}
+
+void ProofDatabase::close()
+{
+    this->file.close();
+    this->keys = nullptr;
+    this->flags = nullptr;
+    this->count = 0;
+    this->maxPieces = 0;
+}
+
+/**
+ * @brief Looks up what is known about a position.
+ *
+ * @param position The position, which may be waiting for a random redirect.
+ * @return Its PROOF_DATABASE_* flags, 0 if no database is open or it doesn't have the position.
+ */
+uint8_t ProofDatabase::probe(const Position &position) const
+{
+    if (!isOpen() || position.filled > this->maxPieces)
+        return 0;
+
+    int symmetry;
+    uint64_t key = Symmetry::canonicalHash(position, symmetry);
+    const uint64_t *found = lower_bound(this->keys, this->keys + this->count, key);
+    if (found == this->keys + this->count || *found != key)
+        return 0;
+
+    return this->flags[found - this->keys];
+}
+
+#endif
@@ -0,0 +1,473 @@
+#ifndef PROOF_NUMBER_SEARCH_H
+#define PROOF_NUMBER_SEARCH_H
+
+#include "../../helpers/BitBoard.h"
+#include "../base/Position.h"
+#include "./ProofDatabase.h"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+const uint32_t PNS_INFINITY = 1u << 30;
+const size_t PNS_DEFAULT_MEMORY = (size_t)64 << 20; // Bytes of transposition table.
+const uint64_t PNS_DEFAULT_MAX_NODES = 10000000;
+const double PNS_EPSILON = 0.25;                    // Slack of the 1 + epsilon trick, see mid().
+const uint64_t PNS_ATTACKER_KEY = 0x50726f6f664e6f21ULL; // XORed into the keys when player -1 attacks.
+const uint8_t PNS_NO_MOVE = 0xFF;
+
+// What a search found out about the player to move at the root.
+const int PNS_UNKNOWN = 0;    // The node limit ran out first.
+const int PNS_PROVEN = 1;     // The player to move wins, whatever the opponent and the redirects do.
+const int PNS_DISPROVEN = 2;  // The opponent can hold it to a draw or better, or a redirect can.
+
+/**
+ * @brief A node of the proof number search.
+ *
+ * @param key The position hash, salted with the attacker. 0 for an empty slot.
+ * @param pn The proof number: how many more leaves must be proven to prove the node.
+ * @param dn The disproof number: the same for disproving it.
+ * @param work Nodes searched under the node, which decides what a full slot keeps.
+ * @param bestMove The most promising move (board * 9 + cell), the board a redirect picks, or PNS_NO_MOVE.
+ */
+struct ProofEntry
+{
+    uint64_t key;
+    uint32_t pn;
+    uint32_t dn;
+    uint32_t work;
+    uint8_t bestMove;
+};
+
+/**
+ * @brief A position a search proved or disproved, as the proof database stores it.
+ *
+ * @param key Symmetry::canonicalHash() of the position.
+ * @param flags What was settled, PROOF_DATABASE_* for the player to move.
+ * @param pieces The pieces on the grid.
+ */
+struct ProofSettled
+{
+    uint64_t key;
+    uint8_t flags;
+    uint8_t pieces;
+};
+
+/**
+ * @brief The outcome of ProofNumberSearch::solve().
+ */
+struct ProofResult
+{
+    int status;     // PNS_UNKNOWN, PNS_PROVEN or PNS_DISPROVEN
+    int move;       // A winning move (board * 9 + cell) when proven, else -1.
+    uint32_t pn;    // Proof and disproof numbers of the root.
+    uint32_t dn;
+    uint64_t nodes; // Nodes searched.
+    double elapsedMs;
+};
+
+/**
+ * @brief Depth-first proof number search (df-pn), proving or disproving a forced win.
+ *
+ * The player to move at the root is the attacker, unless solve() is given another. Its nodes are OR nodes, one winning
+ * move proves them. The defender's nodes are AND nodes, and so are random redirects: the
+ * attacker only has a forced win if it wins whichever board the redirect picks. A draw
+ * disproves, like a loss.
+ *
+ * Where a minimax search goes through every move to a fixed depth, df-pn follows the
+ * moves that are closest to a proof or a disproof, so a long forced sequence on one board
+ * costs about as much as its length. Leaves are cut early when the side to move can win
+ * the board it is on, when the attacker has no line left on any board, and by the proof
+ * database when one is open.
+ *
+ * The transposition table holds two entries per slot and keeps the one with more work
+ * under it, so the memory cap only costs search time. It is kept between searches, keyed
+ * by the attacker as well, and finished proofs carry over. Proofs that took enough work
+ * can also be collected, see setSettledLog(), to keep them past the table.
+ */
+class ProofNumberSearch
+{
+private:
+    vector<ProofEntry> table;
+    size_t numEntries;
+    uint64_t mask;
+    int attacker;
+    uint64_t nodes;
+    uint64_t maxNodes;
+    vector<ProofSettled> *settled; // Receives the proofs and disproofs, or nullptr.
+    uint32_t settledMinWork;
+
+    void mid(const Position &position, uint32_t thpn, uint32_t thdn, uint32_t &pn, uint32_t &dn);
+    bool evaluate(const Position &position, uint32_t &pn, uint32_t &dn) const;
+    void lookup(const Position &position, uint32_t &pn, uint32_t &dn) const;
+    const ProofEntry *find(uint64_t key) const;
+    void store(uint64_t key, uint32_t pn, uint32_t dn, uint32_t work, int bestMove);
+    void recordSettled(const Position &position, bool proven);
+    int getChildren(const Position &position, Position children[], uint8_t moves[]) const;
+
+    uint64_t getKey(const Position &position) const
+    {
+        return position.hash ^ (this->attacker == 1 ? 0 : PNS_ATTACKER_KEY);
+    }
+
+    /**
+     * @brief OR nodes are the attacker's moves, everything else (defender moves and redirects) is an AND node.
+     */
+    bool isOrNode(const Position &position) const
+    {
+        return position.toMove == this->attacker && position.board != POSITION_ANY_BOARD;
+    }
+
+    static uint32_t add(uint32_t a, uint32_t b)
+    {
+        return a + b >= PNS_INFINITY ? PNS_INFINITY : a + b;
+    }
+
+public:
+    ProofNumberSearch(size_t memoryBytes = PNS_DEFAULT_MEMORY);
+
+    ProofResult solve(const Position &position, uint64_t maxNodes = PNS_DEFAULT_MAX_NODES);
+    ProofResult solve(const Position &position, int attacker, uint64_t maxNodes);
+    void clear();
+    void setSettledLog(vector<ProofSettled> *log, uint32_t minWork);
+};
+
+/**
+ * @brief Constructor
+ *
+ * @param memoryBytes The memory cap of the transposition table. Rounded down to a power
+ * of two number of entries. The table is allocated by the first solve().
+ */
+ProofNumberSearch::ProofNumberSearch(size_t memoryBytes)
+    : numEntries(2),
+      attacker(1),
+      nodes(0),
+      maxNodes(0),
+      settled(nullptr),
+      settledMinWork(0)
+{
+    while (this->numEntries * 2 * sizeof(ProofEntry) <= memoryBytes)
+        this->numEntries *= 2;
+
+    this->mask = (this->numEntries - 1) & ~(uint64_t)1;
+}
+
+/**
+ * @brief Forgets every stored node.
+ */
+void ProofNumberSearch::clear()
+{
+    if (!this->table.empty())
+        this->table.assign(this->numEntries, ProofEntry());
+}
+
+/**
+ * @brief Collects the positions the searches prove or disprove from now on.
+ *
+ * Only nodes with at least minWork nodes searched under them are added, the rest are
+ * cheaper to search again than to keep. The same position may be added more than once.
+ *
+ * @param log Receives the positions, or nullptr to stop collecting.
+ * @param minWork The least work a node needs to be added.
+ */
+void ProofNumberSearch::setSettledLog(vector<ProofSettled> *log, uint32_t minWork)
+{
+    this->settled = log;
+    this->settledMinWork = minWork;
+}
+
+/**
+ * @brief Tries to prove a forced win for the player to move.
+ *
+ * @param position The position. It may be a random redirect (POSITION_ANY_BOARD), which
+ * then has no winning move of its own.
+ * @param maxNodes The most nodes to search before giving up.
+ * @return The status of the root, a winning move if proven, and the work done.
+ */
+ProofResult ProofNumberSearch::solve(const Position &position, uint64_t maxNodes)
+{
+    return solve(position, position.toMove, maxNodes);
+}
+
+/**
+ * @brief Tries to prove a forced win for either player.
+ *
+ * @param position The position.
+ * @param attacker The player whose win to prove, 1 or -1.
+ * @param maxNodes The most nodes to search before giving up.
+ * @return The status of the root, a winning move if proven for the player to move, and
+ * the work done.
+ */
+ProofResult ProofNumberSearch::solve(const Position &position, int attacker, uint64_t maxNodes)
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    if (this->table.empty())
+        this->table.assign(this->numEntries, ProofEntry());
+
+    this->attacker = attacker;
+    this->nodes = 0;
+    this->maxNodes = maxNodes;
+
+    ProofResult result;
+    if (!evaluate(position, result.pn, result.dn))
+        mid(position, PNS_INFINITY, PNS_INFINITY, result.pn, result.dn);
+
+    result.status = result.pn == 0 ? PNS_PROVEN : result.dn == 0 ? PNS_DISPROVEN : PNS_UNKNOWN;
+    result.move = -1;
+    result.nodes = this->nodes;
+
+    // The winning move is the best move stored at the root, or the child with a proof
+    // when the root was decided without a search or lost from the table.
+    if (result.status == PNS_PROVEN && position.toMove == attacker && position.board != POSITION_ANY_BOARD)
+    {
+        const ProofEntry *entry = find(getKey(position));
+        if (entry && entry->pn == 0 && entry->bestMove != PNS_NO_MOVE)
+            result.move = entry->bestMove;
+
+        Position children[POSITION_NUM_MOVES];
+        uint8_t moves[POSITION_NUM_MOVES];
+        int count = result.move < 0 ? getChildren(position, children, moves) : 0;
+        for (int i = 0; i < count && result.move < 0; i++)
+        {
+            uint32_t pn, dn;
+            lookup(children[i], pn, dn);
+            if (pn == 0)
+                result.move = moves[i];
+        }
+    }
+
+    result.elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+/**
+ * @brief Lists the positions a node leads to.
+ *
+ * @param moves Receives the move (board * 9 + cell) of each child, or the board a
+ * redirect picks.
+ * @return The number of children.
+ */
+int ProofNumberSearch::getChildren(const Position &position, Position children[], uint8_t moves[]) const
+{
+    int count = 0;
+
+    if (position.board == POSITION_ANY_BOARD)
+    {
+        for (uint16_t open = position.openBoards(); open; open &= open - 1)
+        {
+            moves[count] = (uint8_t)BitBoard::lowestBit(open);
+            children[count] = position;
+            children[count].setBoard(moves[count]);
+            count++;
+        }
+        return count;
+    }
+
+    for (uint16_t empty = position.emptyCells(position.board); empty; empty &= empty - 1)
+    {
+        int cell = BitBoard::lowestBit(empty);
+        moves[count] = (uint8_t)(position.board * 9 + cell);
+        children[count] = position;
+        children[count].play(position.board, cell);
+        count++;
+    }
+    return count;
+}
+
+/**
+ * @brief Scores positions that are decided without a search.
+ *
+ * @return `true` if the position is proven or disproven, with pn and dn set.
+ */
+bool ProofNumberSearch::evaluate(const Position &position, uint32_t &pn, uint32_t &dn) const
+{
+    bool won = false, decided = true;
+
+    uint8_t flags = ProofDatabase::instance().probe(position);
+    bool toMove = position.toMove == this->attacker;
+
+    if (!position.isRunning())
+        won = position.status == this->attacker;
+    else if (flags & (toMove ? PROOF_DATABASE_WIN : PROOF_DATABASE_LOSS))
+        won = true;
+    else if (flags & (toMove ? PROOF_DATABASE_NO_WIN : PROOF_DATABASE_NO_LOSS))
+        won = false;
+    else if (position.isDead())
+        won = false;
+    else if (position.board != POSITION_ANY_BOARD &&
+             BitBoard::canWin(position.masks[Position::side(position.toMove)][position.board],
+                              position.masks[1 - Position::side(position.toMove)][position.board]))
+        won = toMove; // The side to move wins on its next move.
+    else
+    {
+        // Lost for the attacker once every board has a defender's cell in each line.
+        int defender = 1 - Position::side(this->attacker);
+        for (int b = 0; b < POSITION_NUM_BOARDS && decided; b++)
+            decided = !BitBoard::hasOpenLine(position.masks[defender][b]);
+    }
+
+    if (!decided)
+        return false;
+
+    pn = won ? 0 : PNS_INFINITY;
+    dn = won ? PNS_INFINITY : 0;
+    return true;
+}
+
+/**
+ * @brief The proof and disproof numbers of a position, from the table or as a new leaf.
+ */
+void ProofNumberSearch::lookup(const Position &position, uint32_t &pn, uint32_t &dn) const
+{
+    const ProofEntry *entry = find(getKey(position));
+    if (entry)
+    {
+        pn = entry->pn;
+        dn = entry->dn;
+    }
+    else if (!evaluate(position, pn, dn))
+    {
+        pn = 1;
+        dn = 1;
+    }
+}
+
+const ProofEntry *ProofNumberSearch::find(uint64_t key) const
+{
+    const ProofEntry *slot = &this->table[key & this->mask];
+    if (slot[0].key == key)
+        return &slot[0];
+    if (slot[1].key == key)
+        return &slot[1];
+    return nullptr;
+}
+
+/**
+ * @brief Stores a node, over the entry of the slot with the least work under it.
+ */
+void ProofNumberSearch::store(uint64_t key, uint32_t pn, uint32_t dn, uint32_t work, int bestMove)
+{
+    ProofEntry *slot = &this->table[key & this->mask];
+    ProofEntry *entry = &slot[0];
+
+    if (slot[1].key == key || (slot[0].key != key && slot[1].work < slot[0].work))
+        entry = &slot[1];
+
+    entry->key = key;
+    entry->pn = pn;
+    entry->dn = dn;
+    entry->work = work;
+    entry->bestMove = (uint8_t)bestMove;
+}
+
+/**
+ * @brief Adds a settled node to the settled log, in the flags of the proof database.
+ *
+ * @param proven `true` if the attacker wins from the node, `false` if it can't.
+ */
+void ProofNumberSearch::recordSettled(const Position &position, bool proven)
+{
+    bool toMove = position.toMove == this->attacker;
+
+    ProofSettled entry;
+    int symmetry;
+    entry.key = Symmetry::canonicalHash(position, symmetry);
+    entry.pieces = (uint8_t)position.filled;
+    if (proven)
+        entry.flags = toMove ? PROOF_DATABASE_WIN | PROOF_DATABASE_NO_LOSS : PROOF_DATABASE_LOSS | PROOF_DATABASE_NO_WIN;
+    else
+        entry.flags = toMove ? PROOF_DATABASE_NO_WIN : PROOF_DATABASE_NO_LOSS;
+
+    this->settled->push_back(entry);
+}
+
+/**
+ * @brief Searches a node until its numbers reach a threshold (multiple iterative deepening).
+ *
+ * The child searched is the most proving one: the lowest proof number at an OR node, the
+ * lowest disproof number at an AND node. It gets thresholds just past the second best
+ * child, so the search moves on once that child looks better. With the 1 + epsilon
+ * trick they are a share epsilon further off, which keeps the search from bouncing
+ * between two close children when the table can't hold both subtrees.
+ *
+ * @param position The node.
+ * @param thpn The proof number threshold.
+ * @param thdn The disproof number threshold.
+ * @param pn Receives the proof number of the node.
+ * @param dn Receives the disproof number of the node.
+ */
+void ProofNumberSearch::mid(const Position &position, uint32_t thpn, uint32_t thdn, uint32_t &pn, uint32_t &dn)
+{
+    uint64_t key = getKey(position);
+    // The work counts every visit, so a node proven over many of them keeps its entry.
+    const ProofEntry *entry = find(key);
+    uint64_t startNodes = this->nodes++ - (entry ? entry->work : 0);
+
+    lookup(position, pn, dn);
+    if (pn >= thpn || dn >= thdn || pn == 0 || dn == 0)
+        return;
+
+    Position children[POSITION_NUM_MOVES];
+    uint8_t moves[POSITION_NUM_MOVES];
+    uint32_t childPn[POSITION_NUM_MOVES], childDn[POSITION_NUM_MOVES];
+    int count = getChildren(position, children, moves);
+    bool orNode = isOrNode(position);
+    int best = 0;
+
+    for (int i = 0; i < count; i++)
+        lookup(children[i], childPn[i], childDn[i]);
+
+    while (true)
+    {
+        // OR: pn = min, dn = sum. AND: pn = sum, dn = min. The child to search is the one
+        // that sets the min.
+        uint32_t minValue = PNS_INFINITY, secondValue = PNS_INFINITY, sum = 0;
+        best = 0;
+        for (int i = 0; i < count; i++)
+        {
+            uint32_t value = orNode ? childPn[i] : childDn[i];
+            sum = add(sum, orNode ? childDn[i] : childPn[i]);
+
+            if (value < minValue)
+            {
+                secondValue = minValue;
+                minValue = value;
+                best = i;
+            }
+            else if (value < secondValue)
+                secondValue = value;
+        }
+
+        pn = orNode ? minValue : sum;
+        dn = orNode ? sum : minValue;
+
+        if (pn >= thpn || dn >= thdn || this->nodes >= this->maxNodes)
+            break;
+
+        uint32_t limit = secondValue >= PNS_INFINITY ? PNS_INFINITY : (uint32_t)(secondValue * (1 + PNS_EPSILON)) + 1;
+        uint32_t childThpn, childThdn;
+        if (orNode)
+        {
+            childThpn = min(thpn, limit);
+            childThdn = thdn >= PNS_INFINITY ? PNS_INFINITY : thdn - dn + childDn[best];
+        }
+        else
+        {
+            childThpn = thpn >= PNS_INFINITY ? PNS_INFINITY : thpn - pn + childPn[best];
+            childThdn = min(thdn, limit);
+        }
+
+        mid(children[best], childThpn, childThdn, childPn[best], childDn[best]);
+    }
+
+    uint64_t work = this->nodes - startNodes;
+    store(key, pn, dn, work > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)work, count ? moves[best] : PNS_NO_MOVE);
+
+    if (this->settled != nullptr && (pn == 0 || dn == 0) && work >= this->settledMinWork)
+        recordSettled(position, pn == 0);
+}
+
+#endif
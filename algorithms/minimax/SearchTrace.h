@@ -0,0 +1,194 @@
+#ifndef SEARCHTRACE_H
+#define SEARCHTRACE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+// Opt-in search tree tracing for Advanced_Minimax.
+//
+// Build with -DNBTTT_SEARCH_TRACE to compile the trace hooks in. Without the flag the
+// TRACE_* macros below expand to nothing, so the search carries no extra state or branches.
+// The file format is always available so tools/TraceReader.cpp can read traces.
+
+const uint32_t TRACE_MAGIC = 0x5254424e; // "NBTR"
+const uint32_t TRACE_VERSION = 1;
+const uint8_t TRACE_FLAG_CUTOFF = 1;
+const uint8_t TRACE_FLAG_LEAF = 2;
+const uint8_t TRACE_FLAG_TABLE = 4; // Score taken from the transposition table.
+const uint8_t TRACE_FLAG_TABLEBASE = 8; // Score taken from the endgame tablebase.
+const size_t TRACE_BUFFER_RECORDS = 4096;
+
+/**
+ * @brief File header, written once at the start of a trace file.
+ */
+struct TraceHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t maxDepth;    // Nodes deeper than this were not recorded.
+    uint32_t sampleEvery; // Only nodes with hash % sampleEvery == 0 were recorded.
+    uint32_t reserved;
+    uint64_t maxRecords;  // Hard cap on the number of records.
+};
+
+/**
+ * @brief One explored node, written when the node returns (post-order).
+ *
+ * Moves are encoded as board * 9 + cell, where board and cell are row * 3 + col.
+ */
+struct TraceRecord
+{
+    uint64_t hash;     // Zobrist hash of the pieces after the move.
+    int32_t alphaIn;
+    int32_t betaIn;
+    int32_t alphaOut;
+    int32_t betaOut;
+    int32_t score;     // Value returned by the node.
+    uint8_t depth;     // Ply of the node, root moves are ply 1.
+    uint8_t move;      // The move leading to the node.
+    uint8_t rootMove;  // The root move this node was searched under.
+    uint8_t flags;     // TRACE_FLAG_*
+};
+
+static_assert(sizeof(TraceRecord) == 32, "TraceRecord must stay 32 bytes");
+
+/**
+ * @brief Buffered writer for trace files.
+ *
+ * There is a single process wide trace, opened by the application. The search only
+ * pays for the trace while it is open.
+ */
+class SearchTrace
+{
+private:
+    FILE *file;
+    TraceHeader header;
+    vector<TraceRecord> buffer;
+    uint64_t written;
+
+    SearchTrace() : file(nullptr), written(0) {}
+
+    void flush();
+
+public:
+    static SearchTrace &instance();
+
+    bool open(const char *path, uint32_t maxDepth, uint32_t sampleEvery, uint64_t maxRecords);
+    void close();
+    bool shouldRecord(uint64_t hash, int depth) const;
+    void record(const TraceRecord &record);
+
+    bool isOpen() const
+    {
+        return this->file != nullptr;
+    }
+
+    ~SearchTrace()
+    {
+        close();
+    }
+};
+
+SearchTrace &SearchTrace::instance()
+{
+    static SearchTrace trace;
+    return trace;
+}
+
+/**
+ * @brief Opens a trace file and writes the header.
+ *
+ * @param path The output file.
+ * @param maxDepth Deepest ply to record.
+ * @param sampleEvery Record roughly one in this many nodes, chosen by hash so the same positions are always kept.
+ * @param maxRecords Stop recording after this many records.
+ * @return `true` if the file was opened.
+ */
+bool SearchTrace::open(const char *path, uint32_t maxDepth, uint32_t sampleEvery, uint64_t maxRecords)
+{
+    close();
+
+    this->file = fopen(path, "wb");
+    if (this->file == nullptr)
+        return false;
+
+    memset(&this->header, 0, sizeof(this->header));
+    this->header.magic = TRACE_MAGIC;
+    this->header.version = TRACE_VERSION;
+    this->header.recordSize = sizeof(TraceRecord);
+    this->header.maxDepth = maxDepth;
+    this->header.sampleEvery = sampleEvery < 1 ? 1 : sampleEvery;
+    this->header.maxRecords = maxRecords;
+
+    fwrite(&this->header, sizeof(this->header), 1, this->file);
+
+    this->buffer.clear();
+    this->buffer.reserve(TRACE_BUFFER_RECORDS);
+    this->written = 0;
+
+    return true;
+}
+
+/**
+ * @brief Flushes the remaining records and closes the file.
+ */
+void SearchTrace::close()
+{
+    if (this->file == nullptr)
+        return;
+
+    flush();
+    fclose(this->file);
+    this->file = nullptr;
+}
+
+/**
+ * @brief Checks the depth, sampling and size limits for a node.
+ */
+bool SearchTrace::shouldRecord(uint64_t hash, int depth) const
+{
+    return this->file != nullptr &&
+           depth <= (int)this->header.maxDepth &&
+           hash % this->header.sampleEvery == 0 &&
+           this->written + this->buffer.size() < this->header.maxRecords;
+}
+
+void SearchTrace::record(const TraceRecord &record)
+{
+    this->buffer.push_back(record);
+
+    if (this->buffer.size() >= TRACE_BUFFER_RECORDS)
+        flush();
+}
+
+void SearchTrace::flush()
+{
+    if (!this->buffer.empty())
+    {
+        fwrite(this->buffer.data(), sizeof(TraceRecord), this->buffer.size(), this->file);
+        this->written += this->buffer.size();
+        this->buffer.clear();
+    }
+}
+
+#ifdef NBTTT_SEARCH_TRACE
+#define TRACE_STATE(declaration) declaration
+#define TRACE(statement) \
+    do                   \
+    {                    \
+        statement;       \
+    } while (0)
+#else
+#define TRACE_STATE(declaration)
+#define TRACE(statement) \
+    do                   \
+    {                    \
+    } while (0)
+#endif
+
+#endif
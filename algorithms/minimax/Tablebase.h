@@ -0,0 +1,530 @@
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include "../../helpers/BitBoard.h"
+#include "../../helpers/MappedFile.h"
+#include "../base/Position.h"
+#include "../base/Symmetry.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// Endgame tablebase: the exact value of every position with at most a few empty cells.
+//
+// tools/TablebaseGen.cpp builds the file by retrograde analysis and the engines read it
+// through a memory mapping, see Tablebase. This header also holds the position encoding
+// both of them share.
+
+const uint32_t TABLEBASE_MAGIC = 0x4254424e; // "NBTB"
+const uint32_t TABLEBASE_VERSION = 1;
+const int TABLEBASE_MAX_EMPTIES = 4;     // The most empty cells a key holds.
+const int TABLEBASE_DEFAULT_EMPTIES = 3; // About 2 million positions, a 20 MB file.
+const int TABLEBASE_CELL_BITS = 7;       // An empty cell, board * 9 + cell.
+const int TABLEBASE_OPTION_BITS = 6;     // The needs of a board, see TablebaseTables.
+const int TABLEBASE_BOARD_BITS = 4;      // The board to move on.
+const int TABLEBASE_NO_CELL = 127;       // Pads the cells of a key with fewer empty cells.
+const double TABLEBASE_VALUE_SCALE = 32767.0;
+
+// What a move in a TablebaseState leads to.
+const int TABLEBASE_MOVE_RUNNING = 0;
+const int TABLEBASE_MOVE_WIN = 1;  // The move completed a line.
+const int TABLEBASE_MOVE_DRAW = 2; // The move took the last cell.
+
+/**
+ * @brief File header of a tablebase.
+ *
+ * It is followed by `count` sorted keys (uint64_t) and then `count` values (int16_t),
+ * the value of key i at index i.
+ */
+struct TablebaseHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t keySize;
+    uint32_t valueSize;
+    uint32_t maxEmpties; // Every position with this many empty cells or fewer is stored.
+    uint32_t reserved;
+    uint64_t count;
+};
+
+static_assert(sizeof(TablebaseHeader) == 32, "TablebaseHeader must stay 32 bytes");
+
+/**
+ * @brief What is left of a board that still matters.
+ *
+ * Once a board has few empty cells the pieces on it only matter through the lines they
+ * leave open. A need is the set of empty cells that completes a line the other side has
+ * no piece on, and only the smallest needs count. Each family is a bit set over the
+ * subsets of `empty`, a subset being numbered by packing its cells onto the empty ones,
+ * so up to 4 empty cells fit in 16 bits.
+ */
+struct TablebaseBoard
+{
+    uint16_t empty;
+    uint16_t own;   // Needs of the player to move.
+    uint16_t enemy; // Needs of the other player.
+};
+
+/**
+ * @brief A late position as the tablebase sees it.
+ *
+ * It is always seen from the player to move, so the side to move is not part of it.
+ */
+struct TablebaseState
+{
+    TablebaseBoard boards[POSITION_NUM_BOARDS];
+    int board;   // The board to move on, or POSITION_ANY_BOARD.
+    int empties; // Empty cells on the whole grid.
+
+    bool fromMasks(const uint16_t own[POSITION_NUM_BOARDS], const uint16_t enemy[POSITION_NUM_BOARDS], int board, int maxEmpties);
+    int play(int cell, TablebaseState &child) const;
+    uint64_t getKey(int symmetry) const;
+    uint64_t getCanonicalKey() const;
+
+    static uint16_t compress(uint16_t mask, uint16_t empty);
+    static uint16_t expand(uint16_t subset, uint16_t empty);
+    static uint16_t getNeeds(uint16_t empty, uint16_t blockers);
+    static uint16_t minimise(uint16_t family);
+    static void sortCells(int *cells, int count);
+};
+
+/**
+ * @brief Tables of the position encoding, built once at startup.
+ *
+ * `options[empty]` lists every pair of need families a board with these empty cells can
+ * have, as own << 16 | enemy in increasing order. A key stores a board as its index in
+ * that list, which is never more than 42.
+ */
+struct TablebaseTables
+{
+    vector<uint32_t> options[BITBOARD_NUM_MASKS];
+
+    TablebaseTables()
+    {
+        // Every way to fill the other cells without a line gives one option.
+        for (int empty = 1; empty < BITBOARD_NUM_MASKS; empty++)
+        {
+            if (BitBoard::popCount(empty) > TABLEBASE_MAX_EMPTIES)
+                continue;
+
+            uint16_t taken = (uint16_t)(~empty & BITBOARD_FULL);
+            vector<uint32_t> &list = this->options[empty];
+            for (uint16_t own = taken;; own = (uint16_t)((own - 1) & taken))
+            {
+                uint16_t enemy = taken & ~own;
+                if (!BitBoard::isWin(own) && !BitBoard::isWin(enemy))
+                    list.push_back((uint32_t)TablebaseState::getNeeds(empty, enemy) << 16 | TablebaseState::getNeeds(empty, own));
+                if (own == 0)
+                    break;
+            }
+
+            sort(list.begin(), list.end());
+            list.erase(unique(list.begin(), list.end()), list.end());
+        }
+    }
+
+    int getOption(const TablebaseBoard &board) const
+    {
+        const vector<uint32_t> &list = this->options[board.empty];
+        uint32_t option = (uint32_t)board.own << 16 | board.enemy;
+        vector<uint32_t>::const_iterator found = lower_bound(list.begin(), list.end(), option);
+
+        return found != list.end() && *found == option ? (int)(found - list.begin()) : -1;
+    }
+};
+
+const TablebaseTables TABLEBASE_TABLES;
+
+/**
+ * @brief Packs the cells of a mask onto the empty cells (a software pext).
+ */
+uint16_t TablebaseState::compress(uint16_t mask, uint16_t empty)
+{
+    uint16_t subset = 0;
+    int bit = 0;
+    for (; empty; empty &= empty - 1, bit++)
+        if (mask & empty & -empty)
+            subset |= (uint16_t)(1 << bit);
+    return subset;
+}
+
+/**
+ * @brief Undoes compress(), turning a subset back into cells (a software pdep).
+ */
+uint16_t TablebaseState::expand(uint16_t subset, uint16_t empty)
+{
+    uint16_t mask = 0;
+    for (; empty; empty &= empty - 1, subset >>= 1)
+        if (subset & 1)
+            mask |= empty & -empty;
+    return mask;
+}
+
+/**
+ * @brief Sorts the empty cells of a key, at most TABLEBASE_MAX_EMPTIES, by insertion.
+ *
+ * std::sort is no faster on so few cells, and g++ -O2 warns (-Warray-bounds) about the
+ * branches of it that only run on longer arrays.
+ */
+void TablebaseState::sortCells(int *cells, int count)
+{
+    for (int i = 1; i < count; i++)
+    {
+        int cell = cells[i];
+        int j = i;
+        for (; j > 0 && cells[j - 1] > cell; j--)
+            cells[j] = cells[j - 1];
+        cells[j] = cell;
+    }
+}
+
+/**
+ * @brief Finds the needs of a side on a board.
+ *
+ * @param empty The empty cells of the board, at most TABLEBASE_MAX_EMPTIES.
+ * @param blockers The other side's pieces.
+ * @return The family of smallest needs. It holds the empty subset (bit 0) if a line is complete.
+ */
+uint16_t TablebaseState::getNeeds(uint16_t empty, uint16_t blockers)
+{
+    uint16_t family = 0;
+    for (int line = 0; line < BITBOARD_NUM_LINES; line++)
+        if (!(BITBOARD_LINES[line] & blockers))
+            family |= (uint16_t)(1 << compress(BITBOARD_LINES[line], empty));
+
+    return minimise(family);
+}
+
+/**
+ * @brief Drops every need that holds a smaller one.
+ */
+uint16_t TablebaseState::minimise(uint16_t family)
+{
+    uint16_t kept = family;
+    for (uint16_t rest = family; rest; rest &= rest - 1)
+    {
+        int need = BitBoard::lowestBit(rest);
+        for (uint16_t other = family; other; other &= other - 1)
+        {
+            int smaller = BitBoard::lowestBit(other);
+            if (smaller != need && (smaller & need) == smaller)
+            {
+                kept &= (uint16_t)~(1 << need);
+                break;
+            }
+        }
+    }
+    return kept;
+}
+
+/**
+ * @brief Builds the state of a position.
+ *
+ * @param own The pieces of the player to move, one mask per board.
+ * @param enemy The pieces of the other player.
+ * @param board The board to move on. A full board counts as POSITION_ANY_BOARD.
+ * @param maxEmpties The most empty cells the caller can handle.
+ * @return `false` if the game is over or there are more than maxEmpties empty cells.
+ */
+bool TablebaseState::fromMasks(const uint16_t own[POSITION_NUM_BOARDS], const uint16_t enemy[POSITION_NUM_BOARDS], int board, int maxEmpties)
+{
+    this->empties = 0;
+    for (int b = 0; b < POSITION_NUM_BOARDS; b++)
+        this->empties += BitBoard::popCount(~(own[b] | enemy[b]) & BITBOARD_FULL);
+
+    if (this->empties == 0 || this->empties > maxEmpties || this->empties > TABLEBASE_MAX_EMPTIES)
+        return false;
+
+    for (int b = 0; b < POSITION_NUM_BOARDS; b++)
+    {
+        if (BitBoard::isWin(own[b]) || BitBoard::isWin(enemy[b]))
+            return false;
+
+        TablebaseBoard &state = this->boards[b];
+        state.empty = (uint16_t)(~(own[b] | enemy[b]) & BITBOARD_FULL);
+        state.own = state.empty ? getNeeds(state.empty, enemy[b]) : 0;
+        state.enemy = state.empty ? getNeeds(state.empty, own[b]) : 0;
+    }
+
+    this->board = board != POSITION_ANY_BOARD && this->boards[board].empty ? board : POSITION_ANY_BOARD;
+    return true;
+}
+
+/**
+ * @brief Plays a cell on the current board, which must not be POSITION_ANY_BOARD.
+ *
+ * @param cell An empty cell of the current board.
+ * @param child Receives the position for the other player when the game goes on. Its
+ * board is POSITION_ANY_BOARD if the move points to a full board.
+ * @return TABLEBASE_MOVE_RUNNING, TABLEBASE_MOVE_WIN or TABLEBASE_MOVE_DRAW.
+ */
+int TablebaseState::play(int cell, TablebaseState &child) const
+{
+    const TablebaseBoard &from = this->boards[this->board];
+    uint16_t subset = compress((uint16_t)(1 << cell), from.empty);
+
+    if (from.own & (1 << subset))
+        return TABLEBASE_MOVE_WIN;
+    if (this->empties == 1)
+        return TABLEBASE_MOVE_DRAW;
+
+    // The other player moves next, so the families swap.
+    for (int b = 0; b < POSITION_NUM_BOARDS; b++)
+    {
+        child.boards[b].empty = this->boards[b].empty;
+        child.boards[b].own = this->boards[b].enemy;
+        child.boards[b].enemy = this->boards[b].own;
+    }
+
+    // The mover's needs lose the cell, the other player's needs through it are blocked.
+    TablebaseBoard &to = child.boards[this->board];
+    to.empty = (uint16_t)(from.empty & ~(1 << cell));
+    to.own = 0;
+    to.enemy = 0;
+
+    for (uint16_t needs = from.own; needs; needs &= needs - 1)
+    {
+        uint16_t need = expand((uint16_t)BitBoard::lowestBit(needs), from.empty);
+        to.enemy |= (uint16_t)(1 << compress(need, to.empty));
+    }
+    for (uint16_t needs = from.enemy; needs; needs &= needs - 1)
+    {
+        int need = BitBoard::lowestBit(needs);
+        if (!(need & subset))
+            to.own |= (uint16_t)(1 << compress(expand((uint16_t)need, from.empty), to.empty));
+    }
+    to.enemy = minimise(to.enemy);
+
+    child.empties = this->empties - 1;
+    child.board = child.boards[cell].empty ? cell : POSITION_ANY_BOARD;
+
+    return TABLEBASE_MOVE_RUNNING;
+}
+
+/**
+ * @brief Encodes the state as seen through one symmetry of the grid.
+ *
+ * From the top bit down: the empty cells in increasing order, padded with
+ * TABLEBASE_NO_CELL; the option of each board with empty cells, by board; the board to
+ * move on. The same symmetry moves both the boards and the cells inside them.
+ *
+ * @return The key, or 0 if a board is not in TablebaseTables.
+ */
+uint64_t TablebaseState::getKey(int symmetry) const
+{
+    TablebaseBoard mapped[POSITION_NUM_BOARDS] = {};
+    int cells[TABLEBASE_MAX_EMPTIES];
+    int numCells = 0;
+
+    for (int b = 0; b < POSITION_NUM_BOARDS; b++)
+    {
+        const TablebaseBoard &from = this->boards[b];
+        if (!from.empty)
+            continue;
+
+        TablebaseBoard &to = mapped[Symmetry::cell(symmetry, b)];
+        to.empty = Symmetry::mask(symmetry, from.empty);
+
+        for (uint16_t empty = to.empty; empty; empty &= empty - 1)
+            cells[numCells++] = Symmetry::cell(symmetry, b) * 9 + BitBoard::lowestBit(empty);
+        for (uint16_t needs = from.own; needs; needs &= needs - 1)
+            to.own |= (uint16_t)(1 << compress(Symmetry::mask(symmetry, expand((uint16_t)BitBoard::lowestBit(needs), from.empty)), to.empty));
+        for (uint16_t needs = from.enemy; needs; needs &= needs - 1)
+            to.enemy |= (uint16_t)(1 << compress(Symmetry::mask(symmetry, expand((uint16_t)BitBoard::lowestBit(needs), from.empty)), to.empty));
+    }
+
+    sortCells(cells, numCells);
+
+    uint64_t key = 0;
+    for (int i = 0; i < TABLEBASE_MAX_EMPTIES; i++)
+        key = key << TABLEBASE_CELL_BITS | (uint64_t)(i < numCells ? cells[i] : TABLEBASE_NO_CELL);
+
+    int numOptions = 0;
+    for (int b = 0; b < POSITION_NUM_BOARDS; b++)
+    {
+        if (!mapped[b].empty)
+            continue;
+
+        int option = TABLEBASE_TABLES.getOption(mapped[b]);
+        if (option < 0)
+            return 0;
+
+        key = key << TABLEBASE_OPTION_BITS | (uint64_t)option;
+        numOptions++;
+    }
+    for (; numOptions < TABLEBASE_MAX_EMPTIES; numOptions++)
+        key <<= TABLEBASE_OPTION_BITS;
+
+    int board = this->board == POSITION_ANY_BOARD ? POSITION_ANY_BOARD : Symmetry::cell(symmetry, this->board);
+    return key << TABLEBASE_BOARD_BITS | (uint64_t)board;
+}
+
+/**
+ * @brief The smallest key over the symmetries, the one the tablebase stores.
+ */
+uint64_t TablebaseState::getCanonicalKey() const
+{
+    uint64_t best = getKey(SYMMETRY_IDENTITY);
+    for (int s = 1; s < SYMMETRY_COUNT; s++)
+        best = min(best, getKey(s));
+    return best;
+}
+
+/**
+ * @brief Read only access to a tablebase file.
+ *
+ * The file is memory mapped, so opening it reads nothing and a probe touches a few pages
+ * of the sorted keys for its binary search. There is a single process wide tablebase,
+ * opened by the application.
+ *
+ * A value is the expected result for the player to move, 1 for a win and -1 for a loss.
+ * Positions where the game is only decided by which board a random redirect picks have
+ * a value in between, averaged over the boards the redirect can pick.
+ */
+class Tablebase
+{
+private:
+    MappedFile file;
+    const uint64_t *keys;
+    const int16_t *values;
+    uint64_t count;
+    int maxEmpties;
+
+    Tablebase() : keys(nullptr), values(nullptr), count(0), maxEmpties(0) {}
+
+    bool find(uint64_t key, double &value) const;
+
+public:
+    static Tablebase &instance();
+
+    bool open(const char *path);
+    void close();
+    bool probe(const uint16_t own[POSITION_NUM_BOARDS], const uint16_t enemy[POSITION_NUM_BOARDS], int board, double &value) const;
+    bool probe(const TablebaseState &state, double &value) const;
+    bool probe(const Position &position, double &value) const;
+
+    bool isOpen() const
+    {
+        return this->keys != nullptr;
+    }
+
+    int getMaxEmpties() const
+    {
+        return this->maxEmpties;
+    }
+};
+
+Tablebase &Tablebase::instance()
+{
+    static Tablebase tablebase;
+    return tablebase;
+}
+
+/**
+ * @brief Maps a tablebase file and checks its header.
+ *
+ * @param path The file written by tools/TablebaseGen.cpp.
+ * @return `true` if the file is a tablebase of this version.
+ */
+bool Tablebase::open(const char *path)
+{
+    close();
+
+    if (!this->file.open(path))
+        return false;
+
+    const TablebaseHeader *header = (const TablebaseHeader *)this->file.getData();
+    if (this->file.getSize() < sizeof(TablebaseHeader) || header->magic != TABLEBASE_MAGIC ||
+        header->version != TABLEBASE_VERSION || header->keySize != sizeof(uint64_t) ||
+        header->valueSize != sizeof(int16_t) || header->maxEmpties > (uint32_t)TABLEBASE_MAX_EMPTIES ||
+        this->file.getSize() != sizeof(TablebaseHeader) + header->count * (sizeof(uint64_t) + sizeof(int16_t)))
+    {
+        this->file.close();
+        return false;
+    }
+
+    this->count = header->count;
+    this->maxEmpties = (int)header->maxEmpties;
+    this->keys = (const uint64_t *)(this->file.getData() + sizeof(TablebaseHeader));
+    this->values = (const int16_t *)(this->keys + this->count);
+
+    return true;
+}
+
+void Tablebase::close()
+{
+    this->file.close();
+    this->keys = nullptr;
+    this->values = nullptr;
+    this->count = 0;
+    this->maxEmpties = 0;
+}
+
+/**
+ * @brief Binary search for a canonical key.
+ */
+bool Tablebase::find(uint64_t key, double &value) const
+{
+    const uint64_t *found = lower_bound(this->keys, this->keys + this->count, key);
+    if (found == this->keys + this->count || *found != key)
+        return false;
+
+    value = this->values[found - this->keys] / TABLEBASE_VALUE_SCALE;
+    return true;
+}
+
+/**
+ * @brief Looks up a position given as the masks of both players.
+ *
+ * @param own The pieces of the player to move, one mask per board (row * 3 + col).
+ * @param enemy The pieces of the other player.
+ * @param board The board to move on. When it is full the value is averaged over the
+ * boards the random redirect can pick.
+ * @param value Receives the value for the player to move, from -1 to 1.
+ * @return `false` if the position has too many empty cells, is over, or no file is open.
+ */
+bool Tablebase::probe(const uint16_t own[POSITION_NUM_BOARDS], const uint16_t enemy[POSITION_NUM_BOARDS], int board, double &value) const
+{
+    TablebaseState state;
+    if (!isOpen() || !state.fromMasks(own, enemy, board, this->maxEmpties))
+        return false;
+
+    return probe(state, value);
+}
+
+bool Tablebase::probe(const TablebaseState &state, double &value) const
+{
+    if (state.board != POSITION_ANY_BOARD)
+        return find(state.getCanonicalKey(), value);
+
+    TablebaseState redirected = state;
+    double total = 0;
+    int boards = 0;
+    for (int b = 0; b < POSITION_NUM_BOARDS; b++)
+    {
+        if (!state.boards[b].empty)
+            continue;
+
+        double boardValue;
+        redirected.board = b;
+        if (!find(redirected.getCanonicalKey(), boardValue))
+            return false;
+
+        total += boardValue;
+        boards++;
+    }
+
+    value = total / boards;
+    return true;
+}
+
+bool Tablebase::probe(const Position &position, double &value) const
+{
+    int own = Position::side(position.toMove);
+    return position.isRunning() && probe(position.masks[own], position.masks[1 - own], position.board, value);
+}
+
+#endif
@@ -0,0 +1,236 @@
+#ifndef THREAT_SPACE_SEARCH_H
+#define THREAT_SPACE_SEARCH_H
+
+#include "../../helpers/BitBoard.h"
+#include "../base/Position.h"
+
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+const int TSS_DEFAULT_DEPTH = 10;            // Attacker moves, so 20 plies.
+const int TSS_MAX_DEFENCES = 4;              // Safe replies a move may leave to count as forcing.
+const uint64_t TSS_DEFAULT_MAX_NODES = 100000;
+const int TSS_TABLE_BITS = 16;               // Entries of the table of failed attacks, as a power of two.
+
+/**
+ * @brief Threat-space search: looks for a win by a sequence of forcing sends.
+ *
+ * The attacker, the player to move, threatens to win on every board where it holds two
+ * cells of a line with the third empty. A move on board A sends the opponent to board B,
+ * and every reply on B sends the attacker on to another board. Replies that send it to a
+ * board it can win at once lose, so the only defences are the replies that don't, and a
+ * move is forcing when it leaves the opponent at most TSS_MAX_DEFENCES of them.
+ *
+ * Only forcing moves are searched for the attacker and only the defences for the
+ * opponent, so the tree stays narrow and a search goes far deeper than the alpha-beta
+ * search in the same time. Random redirects are searched for every board they can pick.
+ * A win found is a real forced win; a win that needs quiet moves is not found.
+ *
+ * The same position is often reached by sends in another order, so attacks that failed
+ * are remembered with the depth they had, in a table kept between searches.
+ */
+class ThreatSpaceSearch
+{
+private:
+    int maxDepth;
+    uint64_t maxNodes;
+    uint64_t nodes;
+    int attacker;
+    vector<uint64_t> failedKeys;  // Hash of the position, salted with the attacker.
+    vector<uint8_t> failedDepths; // The depth it failed with.
+
+    bool attack(const Position &position, int depth, int *move);
+    bool defend(const Position &position, int depth);
+    bool canWin(const Position &position, int player, int b) const;
+    bool winsAtOnce(const Position &position) const;
+
+public:
+    ThreatSpaceSearch(int maxDepth = TSS_DEFAULT_DEPTH, uint64_t maxNodes = TSS_DEFAULT_MAX_NODES)
+        : maxDepth(maxDepth),
+          maxNodes(maxNodes),
+          nodes(0),
+          attacker(1),
+          failedKeys(1 << TSS_TABLE_BITS, 0),
+          failedDepths(1 << TSS_TABLE_BITS, 0)
+    {
+    }
+
+    bool findWin(const Position &position, int &move);
+
+    uint64_t getNodes() const
+    {
+        return this->nodes;
+    }
+};
+
+/**
+ * @brief Looks for a forced win of the player to move.
+ *
+ * @param position The position. Its board must not be POSITION_ANY_BOARD.
+ * @param move Receives the first move of the win (board * 9 + cell).
+ * @return `true` if a win was found within the depth and node limits.
+ */
+bool ThreatSpaceSearch::findWin(const Position &position, int &move)
+{
+    this->nodes = 0;
+    this->attacker = position.toMove;
+
+    if (!position.isRunning() || position.board == POSITION_ANY_BOARD)
+        return false;
+
+    return attack(position, this->maxDepth, &move);
+}
+
+/**
+ * @brief Checks if a player can win board b with its next move.
+ */
+bool ThreatSpaceSearch::canWin(const Position &position, int player, int b) const
+{
+    int s = Position::side(player);
+    return BitBoard::canWin(position.masks[s][b], position.masks[1 - s][b]);
+}
+
+/**
+ * @brief Checks if the attacker, to move, wins at once, on whatever board a redirect picks.
+ */
+bool ThreatSpaceSearch::winsAtOnce(const Position &position) const
+{
+    if (position.board != POSITION_ANY_BOARD)
+        return canWin(position, this->attacker, position.board);
+
+    for (uint16_t open = position.openBoards(); open; open &= open - 1)
+    {
+        if (!canWin(position, this->attacker, BitBoard::lowestBit(open)))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief The attacker to move: a win at once, or a forcing move that wins against every defence.
+ *
+ * @param position The position, with the attacker to move.
+ * @param depth The attacker moves left.
+ * @param move Receives the winning move, or nullptr.
+ */
+bool ThreatSpaceSearch::attack(const Position &position, int depth, int *move)
+{
+    if (++this->nodes > this->maxNodes)
+        return false;
+
+    // A redirect has to be won on every board it can pick.
+    if (position.board == POSITION_ANY_BOARD)
+    {
+        for (uint16_t open = position.openBoards(); open; open &= open - 1)
+        {
+            Position redirected = position;
+            redirected.setBoard(BitBoard::lowestBit(open));
+            if (!attack(redirected, depth, nullptr))
+                return false;
+        }
+        return true;
+    }
+
+    int b = position.board;
+    int s = Position::side(this->attacker);
+    for (uint16_t empty = position.emptyCells(b); empty; empty &= empty - 1)
+    {
+        int cell = BitBoard::lowestBit(empty);
+        if (BitBoard::isWin(position.masks[s][b] | (1 << cell)))
+        {
+            if (move)
+                *move = b * 9 + cell;
+            return true;
+        }
+    }
+
+    if (depth == 0)
+        return false;
+
+    uint64_t key = position.hash ^ (uint64_t)this->attacker;
+    size_t slot = key & ((1 << TSS_TABLE_BITS) - 1);
+    if (this->failedKeys[slot] == key && this->failedDepths[slot] >= depth)
+        return false;
+
+    for (uint16_t empty = position.emptyCells(b); empty; empty &= empty - 1)
+    {
+        int cell = BitBoard::lowestBit(empty);
+        Position next = position;
+        next.play(b, cell);
+
+        if (next.isRunning() && defend(next, depth - 1))
+        {
+            if (move)
+                *move = b * 9 + cell;
+            return true;
+        }
+    }
+
+    // A search cut short by the node limit proves nothing.
+    if (this->nodes <= this->maxNodes)
+    {
+        this->failedKeys[slot] = key;
+        this->failedDepths[slot] = (uint8_t)depth;
+    }
+    return false;
+}
+
+/**
+ * @brief The defender to move: every reply must lose at once or lead to a won attack.
+ *
+ * Fails as soon as the defender can win, draw, or has more than TSS_MAX_DEFENCES
+ * replies that don't lose at once, the move before it not being forcing then.
+ *
+ * @param position The position, with the defender to move.
+ * @param depth The attacker moves left.
+ */
+bool ThreatSpaceSearch::defend(const Position &position, int depth)
+{
+    if (++this->nodes > this->maxNodes)
+        return false;
+
+    if (position.board == POSITION_ANY_BOARD)
+    {
+        for (uint16_t open = position.openBoards(); open; open &= open - 1)
+        {
+            Position redirected = position;
+            redirected.setBoard(BitBoard::lowestBit(open));
+            if (!defend(redirected, depth))
+                return false;
+        }
+        return true;
+    }
+
+    int b = position.board;
+    if (canWin(position, -this->attacker, b))
+        return false;
+
+    Position defences[TSS_MAX_DEFENCES];
+    int numDefences = 0;
+
+    for (uint16_t empty = position.emptyCells(b); empty; empty &= empty - 1)
+    {
+        Position next = position;
+        next.play(b, BitBoard::lowestBit(empty));
+
+        if (!next.isRunning())
+            return false; // The grid filled up: a draw.
+        if (winsAtOnce(next))
+            continue;
+        if (numDefences == TSS_MAX_DEFENCES)
+            return false;
+        defences[numDefences++] = next;
+    }
+
+    for (int i = 0; i < numDefences; i++)
+    {
+        if (!attack(defences[i], depth, nullptr))
+            return false;
+    }
+
+    return true;
+}
+
+#endif
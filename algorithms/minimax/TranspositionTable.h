@@ -0,0 +1,107 @@
+#ifndef TRANSPOSITION_TABLE_H
+#define TRANSPOSITION_TABLE_H
+
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+const int TRANSPOSITION_TABLE_BITS = 16; // 2^16 entries of 16 bytes, 1 MB. Bigger tables push the threat tables out of the cache.
+
+// What the stored score says about the true score of the position.
+const uint8_t TRANSPOSITION_EXACT = 0;
+const uint8_t TRANSPOSITION_LOWER = 1; // The search failed high, the true score is at least this.
+const uint8_t TRANSPOSITION_UPPER = 2; // The search failed low, the true score is at most this.
+
+const uint8_t TRANSPOSITION_NO_MOVE = 0xFF;
+
+/**
+ * @brief A searched position.
+ *
+ * @param key The full Zobrist hash of the position, 0 for an empty slot.
+ * @param score The score the search returned, counting plies from the position itself.
+ * @param bound TRANSPOSITION_EXACT, TRANSPOSITION_LOWER or TRANSPOSITION_UPPER.
+ * @param bestMove The cell (row * 3 + col) that scored best, or TRANSPOSITION_NO_MOVE.
+ * @param rootPly The number of moves on the grid at the root of the search that stored it.
+ * @param draft The plies searched below the position.
+ * @param rootOnly The score counts plies from that root instead, and only holds under it.
+ */
+struct TranspositionEntry
+{
+    uint64_t key;
+    int16_t score;
+    uint8_t bound;
+    uint8_t bestMove;
+    uint8_t rootPly;
+    uint8_t draft;
+    bool rootOnly;
+    uint8_t reserved;
+};
+
+static_assert(sizeof(TranspositionEntry) == 16, "TranspositionEntry must stay 16 bytes");
+
+/**
+ * @brief A fixed size hash table of searched positions, one entry per slot.
+ *
+ * The table outlives a single search. Callers store scores relative to the position,
+ * a win counted in plies from the position rather than from the root, so an entry
+ * searched at least as deep can cut in the next search too. Scores that can't be made
+ * relative are stored as rootOnly. A slot is overwritten by a newer search, or by the
+ * same search once it has something searched at least as deep.
+ */
+class TranspositionTable
+{
+private:
+    vector<TranspositionEntry> entries;
+    uint64_t mask;
+
+public:
+    TranspositionTable(int bits = TRANSPOSITION_TABLE_BITS)
+        : entries((size_t)1 << bits, TranspositionEntry()),
+          mask(((uint64_t)1 << bits) - 1)
+    {
+    }
+
+    /**
+     * @brief Finds a position.
+     *
+     * @return The entry, or nullptr if the position isn't stored.
+     */
+    const TranspositionEntry *probe(uint64_t key) const
+    {
+        const TranspositionEntry &entry = this->entries[key & this->mask];
+        return entry.key == key ? &entry : nullptr;
+    }
+
+    void store(uint64_t key, int score, uint8_t bound, int bestMove, int rootPly, int draft, bool rootOnly);
+};
+
+/**
+ * @brief Stores a position, unless its slot holds a deeper searched node of the same search.
+ *
+ * @param key The full Zobrist hash of the position.
+ * @param score The score the search returned, relative to the position unless rootOnly.
+ * @param bound How the score relates to the true score.
+ * @param bestMove The cell that scored best, or TRANSPOSITION_NO_MOVE.
+ * @param rootPly The number of moves on the grid at the root of the search.
+ * @param draft The plies searched below the position.
+ * @param rootOnly `true` if the score only holds under this root.
+ */
+void TranspositionTable::store(uint64_t key, int score, uint8_t bound, int bestMove, int rootPly, int draft, bool rootOnly)
+{
+    TranspositionEntry &entry = this->entries[key & this->mask];
+
+    // Deeper searched nodes cover more of the tree, keep them over shallower ones.
+    if (entry.key != 0 && entry.key != key && entry.rootPly == rootPly && entry.draft > draft)
+        return;
+
+    entry.key = key;
+    entry.score = (int16_t)score;
+    entry.bound = bound;
+    entry.bestMove = (uint8_t)bestMove;
+    entry.rootPly = (uint8_t)rootPly;
+    entry.draft = (uint8_t)draft;
+    entry.rootOnly = rootOnly;
+}
+
+#endif
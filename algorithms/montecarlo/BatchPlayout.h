@@ -0,0 +1,449 @@
+#ifndef BATCH_PLAYOUT_H
+#define BATCH_PLAYOUT_H
+
+#include "../../helpers/BitBoard.h"
+#include "../../helpers/Random.h"
+#include "../../struct/PlayoutPolicy.h"
+#include "../base/Position.h"
+#include "./HeavyPlayout.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+const int BATCH_PLAYOUT_LANES = 8; // Games per AVX2 register, one 32 bit lane each.
+
+/**
+ * @brief Totals of a batch of random playouts.
+ */
+struct BatchPlayoutResult
+{
+    long long wins[2]; // [0] player 1, [1] player -1
+    long long draws;
+    long long steps;   // Random moves played.
+    int maxPlies;      // Longest playout.
+};
+
+/**
+ * @brief Lookup tables of the vector kernel, laid out for gathers.
+ */
+struct BatchPlayoutTables
+{
+    int32_t popCount[BITBOARD_NUM_MASKS];
+    int32_t isWin[BITBOARD_NUM_MASKS]; // -1 (all bits set) for a win, 0 otherwise.
+    int32_t ternary[BITBOARD_NUM_MASKS];
+    int32_t lines[BITBOARD_NUM_MASKS]; // BitBoardTables::lines, widened for gathers.
+    uint8_t nthBit[BITBOARD_NUM_MASKS * 16 + 4]; // [mask * 16 + n], padded for 4 byte gathers.
+
+    BatchPlayoutTables()
+    {
+        for (int mask = 0; mask < BITBOARD_NUM_MASKS; mask++)
+        {
+            this->popCount[mask] = BitBoard::popCount(mask);
+            this->isWin[mask] = BitBoard::isWin(mask) ? -1 : 0;
+            this->ternary[mask] = BitBoard::ternaryIndex(mask, 0);
+            this->lines[mask] = BITBOARD_TABLES.lines[mask];
+
+            for (int n = 0; n < 16; n++)
+                this->nthBit[mask * 16 + n] = n < this->popCount[mask] ? (uint8_t)BitBoard::nthSetBit(mask, n) : 0;
+        }
+
+        for (int i = 0; i < 4; i++)
+            this->nthBit[BITBOARD_NUM_MASKS * 16 + i] = 0;
+    }
+};
+
+const BatchPlayoutTables BATCH_PLAYOUT_TABLES;
+
+/**
+ * @brief Plays many random games from the same position.
+ *
+ * With AVX2 the games run eight at a time in lockstep: every lane of a register is one
+ * game, the boards are kept as one register per board and player, and each step plays
+ * a random move in every lane at once. Lanes that finish are refilled with a new game
+ * from the start position while there are playouts left, and masked off after that.
+ * Without AVX2 the games are played one by one on a Position.
+ *
+ * A game stops as a draw as soon as no line on any board can be completed any more,
+ * see Position::isDead(), rather than filling in the rest of the grid. Unlike MCTS's
+ * playouts they don't stop on a line the mover can complete: that sharpens a few
+ * thousand playouts but biases flat Monte Carlo once it has more.
+ *
+ * The moves are uniformly random like MCTS's playouts, or heavy (see PlayoutPolicy) with
+ * the same rules as HeavyPlayout. The two versions draw different random numbers.
+ */
+class BatchPlayout
+{
+private:
+#ifdef __AVX2__
+    static __m256i nextRandom(__m256i &state);
+    static __m256i countBits(__m256i masks);
+    static __m256i nthBits(__m256i masks, __m256i n);
+    static __m256i pickBits(__m256i masks, __m256i &state);
+    static __m256i pickHeavyBits(__m256i own, __m256i enemy, __m256i empty, __m256i threshold, __m256i &state);
+    static __m256i laneMask(int bits);
+#endif
+    static void playGames(const Position &start, int count, const PlayoutPolicy &policy, Random &random, BatchPlayoutResult &result);
+
+public:
+    static void run(const Position &start, int count, const PlayoutPolicy &policy, Random &random, BatchPlayoutResult &result);
+};
+
+/**
+ * @brief Plays count games from the start position.
+ *
+ * @param start The position to play from.
+ * @param count The number of games.
+ * @param policy How the games pick their moves.
+ * @param random The random stream of the caller, also seeds the vector lanes.
+ * @param result Receives the totals.
+ */
+void BatchPlayout::run(const Position &start, int count, const PlayoutPolicy &policy, Random &random, BatchPlayoutResult &result)
+{
+    result.wins[0] = result.wins[1] = result.draws = result.steps = 0;
+    result.maxPlies = 0;
+
+    // The game is already decided, every playout ends the same way.
+    if (!start.isRunning() || start.isDead())
+    {
+        if (start.isRunning() || start.status == POSITION_DRAW)
+            result.draws = count;
+        else
+            result.wins[Position::side(start.status)] = count;
+
+        return;
+    }
+
+    if (count > 0)
+        playGames(start, count, policy, random, result);
+}
+
+#ifdef __AVX2__
+
+/**
+ * @brief One xorshift32 step in every lane.
+ */
+__m256i BatchPlayout::nextRandom(__m256i &state)
+{
+    state = _mm256_xor_si256(state, _mm256_slli_epi32(state, 13));
+    state = _mm256_xor_si256(state, _mm256_srli_epi32(state, 17));
+    state = _mm256_xor_si256(state, _mm256_slli_epi32(state, 5));
+    return state;
+}
+
+/**
+ * @brief The number of set bits of a 9 bit mask in every lane.
+ */
+__m256i BatchPlayout::countBits(__m256i masks)
+{
+    return _mm256_i32gather_epi32(BATCH_PLAYOUT_TABLES.popCount, masks, 4);
+}
+
+/**
+ * @brief The index of the n-th set bit of a 9 bit mask in every lane. n must be below the count.
+ */
+__m256i BatchPlayout::nthBits(__m256i masks, __m256i n)
+{
+    __m256i index = _mm256_add_epi32(_mm256_slli_epi32(masks, 4), n);
+    __m256i bits = _mm256_i32gather_epi32((const int *)BATCH_PLAYOUT_TABLES.nthBit, index, 1);
+    return _mm256_and_si256(bits, _mm256_set1_epi32(0xFF));
+}
+
+/**
+ * @brief Picks a random set bit of a 9 bit mask in every lane. Masks must not be 0.
+ */
+__m256i BatchPlayout::pickBits(__m256i masks, __m256i &state)
+{
+    // (16 random bits * count) >> 16 is below count.
+    __m256i draw = _mm256_srli_epi32(nextRandom(state), 16);
+    __m256i n = _mm256_srli_epi32(_mm256_mullo_epi32(draw, countBits(masks)), 16);
+    return nthBits(masks, n);
+}
+
+/**
+ * @brief Picks a heavy move in every lane, the vector form of HeavyPlayout::pickCell().
+ *
+ * The low 16 bits of the draw decide on a random move, the high 16 bits pick the cell.
+ *
+ * @param own The mover's cells on the current board.
+ * @param enemy The enemy's cells on the current board.
+ * @param empty The empty cells of the current board. Must not be 0.
+ * @param threshold The low draw below which the move is random.
+ */
+__m256i BatchPlayout::pickHeavyBits(__m256i own, __m256i enemy, __m256i empty, __m256i threshold, __m256i &state)
+{
+    const __m256i low = _mm256_set1_epi32(0xFFFF);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i draw = nextRandom(state);
+    __m256i high = _mm256_srli_epi32(draw, 16);
+
+    __m256i index = _mm256_add_epi32(_mm256_i32gather_epi32(BATCH_PLAYOUT_TABLES.ternary, own, 4),
+                                     _mm256_slli_epi32(_mm256_i32gather_epi32(BATCH_PLAYOUT_TABLES.ternary, enemy, 4), 1));
+    __m256i threats = _mm256_i32gather_epi32((const int *)HEAVY_PLAYOUT_TABLES.threats, index, 4);
+    __m256i wins = _mm256_and_si256(threats, _mm256_set1_epi32(BITBOARD_FULL));
+    __m256i blocks = _mm256_srli_epi32(threats, HEAVY_PLAYOUT_BLOCK_SHIFT);
+
+    // CENTRE > CORNERS > CROSS, as weights 3, 2 and 1: n counts through the empty cells,
+    // then the good ones, then the centre.
+    __m256i good = _mm256_and_si256(empty, _mm256_set1_epi32(HEAVY_PLAYOUT_TABLES.corners | 1 << HEURISTIC_CENTRE));
+    __m256i best = _mm256_and_si256(empty, _mm256_set1_epi32(1 << HEURISTIC_CENTRE));
+    __m256i emptyCount = countBits(empty);
+    __m256i goodCount = countBits(good);
+    __m256i total = _mm256_add_epi32(_mm256_add_epi32(emptyCount, goodCount), countBits(best));
+    __m256i n = _mm256_srli_epi32(_mm256_mullo_epi32(high, total), 16);
+
+    __m256i inGood = _mm256_cmpgt_epi32(_mm256_add_epi32(n, _mm256_set1_epi32(1)), emptyCount);
+    n = _mm256_sub_epi32(n, _mm256_and_si256(emptyCount, inGood));
+    __m256i inBest = _mm256_and_si256(inGood, _mm256_cmpgt_epi32(_mm256_add_epi32(n, _mm256_set1_epi32(1)), goodCount));
+    __m256i masks = _mm256_blendv_epi8(_mm256_blendv_epi8(empty, good, inGood), best, inBest);
+    n = _mm256_andnot_si256(inBest, n);
+
+    // WIN, else BLOCK, and every so often a random move. These pick uniformly.
+    __m256i hasWins = _mm256_xor_si256(_mm256_cmpeq_epi32(wins, zero), _mm256_set1_epi32(-1));
+    __m256i hasBlocks = _mm256_xor_si256(_mm256_cmpeq_epi32(blocks, zero), _mm256_set1_epi32(-1));
+    __m256i isRandom = _mm256_cmpgt_epi32(threshold, _mm256_and_si256(draw, low));
+
+    __m256i forced = _mm256_blendv_epi8(_mm256_blendv_epi8(blocks, wins, hasWins), empty, isRandom);
+    __m256i isForced = _mm256_or_si256(_mm256_or_si256(hasWins, hasBlocks), isRandom);
+    __m256i forcedN = _mm256_srli_epi32(_mm256_mullo_epi32(high, countBits(forced)), 16);
+
+    masks = _mm256_blendv_epi8(masks, forced, isForced);
+    n = _mm256_blendv_epi8(n, forcedN, isForced);
+    return nthBits(masks, n);
+}
+
+/**
+ * @brief Turns the low 8 bits of an int into an all-ones / all-zeros mask per lane.
+ */
+__m256i BatchPlayout::laneMask(int bits)
+{
+    const __m256i laneBits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    return _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(bits), laneBits), laneBits);
+}
+
+/**
+ * @brief Plays the games eight at a time.
+ *
+ * @param start The position to play from. Must be running.
+ * @param count The number of games, at least 1.
+ * @param policy How the games pick their moves.
+ * @param random Seeds the lanes' random streams.
+ * @param result Adds up the totals.
+ */
+void BatchPlayout::playGames(const Position &start, int count, const PlayoutPolicy &policy, Random &random, BatchPlayoutResult &result)
+{
+    const __m256i threshold = _mm256_set1_epi32((int)(HeavyPlayout::getThreshold(policy.epsilon) >> 16));
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i full = _mm256_set1_epi32(BITBOARD_FULL);
+    const __m256i anyBoard = _mm256_set1_epi32(POSITION_ANY_BOARD);
+    const __m256i allMoves = _mm256_set1_epi32(POSITION_NUM_MOVES);
+
+    // START POSITION, BROADCAST TO EVERY LANE
+    __m256i startMasks[2][POSITION_NUM_BOARDS];
+    for (int b = 0; b < POSITION_NUM_BOARDS; b++)
+    {
+        startMasks[0][b] = _mm256_set1_epi32(start.masks[0][b]);
+        startMasks[1][b] = _mm256_set1_epi32(start.masks[1][b]);
+    }
+    __m256i startFull = _mm256_set1_epi32(start.fullBoards);
+    __m256i startDead = _mm256_set1_epi32(start.deadBoards);
+    __m256i startBoard = _mm256_set1_epi32(start.board);
+    __m256i startSide = _mm256_set1_epi32(start.toMove == 1 ? 0 : -1);
+    __m256i startFilled = _mm256_set1_epi32(start.filled);
+
+    // LANE STATE
+    __m256i masks[2][POSITION_NUM_BOARDS];
+    for (int b = 0; b < POSITION_NUM_BOARDS; b++)
+    {
+        masks[0][b] = startMasks[0][b];
+        masks[1][b] = startMasks[1][b];
+    }
+    __m256i fullBoards = startFull;
+    __m256i deadBoards = startDead;
+    __m256i board = startBoard;
+    __m256i side = startSide; // 0 when player 1 is to move, all ones for player -1.
+    __m256i filled = startFilled;
+    __m256i plies = zero;
+    __m256i longest = zero;
+
+    int32_t seeds[BATCH_PLAYOUT_LANES];
+    for (int lane = 0; lane < BATCH_PLAYOUT_LANES; lane++)
+        seeds[lane] = (int32_t)(random.next() | 1);
+    __m256i state = _mm256_loadu_si256((const __m256i *)seeds);
+
+    int started = std::min(count, BATCH_PLAYOUT_LANES);
+    __m256i active = laneMask((1 << started) - 1);
+
+    while (!_mm256_testz_si256(active, active))
+    {
+        result.steps += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(active)));
+
+        // RANDOM REDIRECTS
+        // Lanes sent to a full board draw one of the open boards first.
+        __m256i redirect = _mm256_cmpeq_epi32(board, anyBoard);
+        if (!_mm256_testz_si256(redirect, active))
+        {
+            __m256i open = _mm256_andnot_si256(fullBoards, full);
+            board = _mm256_blendv_epi8(board, pickBits(open, state), redirect);
+        }
+
+        // MASKS OF THE CURRENT BOARD
+        __m256i isBoard[POSITION_NUM_BOARDS];
+        __m256i current[2] = {zero, zero};
+        for (int b = 0; b < POSITION_NUM_BOARDS; b++)
+        {
+            isBoard[b] = _mm256_cmpeq_epi32(board, _mm256_set1_epi32(b));
+            current[0] = _mm256_or_si256(current[0], _mm256_and_si256(masks[0][b], isBoard[b]));
+            current[1] = _mm256_or_si256(current[1], _mm256_and_si256(masks[1][b], isBoard[b]));
+        }
+
+        // MOVE
+        // Finished lanes hold a full board, so draw from a safe mask and drop the bit.
+        __m256i empty = _mm256_andnot_si256(_mm256_or_si256(current[0], current[1]), full);
+        empty = _mm256_blendv_epi8(one, empty, active);
+
+        __m256i cell;
+        if (policy.heavy)
+        {
+            __m256i own = _mm256_blendv_epi8(current[0], current[1], side);
+            __m256i enemy = _mm256_blendv_epi8(current[1], current[0], side);
+            cell = pickHeavyBits(own, enemy, empty, threshold, state);
+        }
+        else
+        {
+            cell = pickBits(empty, state);
+        }
+        __m256i bit = _mm256_and_si256(_mm256_sllv_epi32(one, cell), active);
+
+        __m256i bits[2] = {_mm256_andnot_si256(side, bit), _mm256_and_si256(side, bit)};
+        for (int b = 0; b < POSITION_NUM_BOARDS; b++)
+        {
+            masks[0][b] = _mm256_or_si256(masks[0][b], _mm256_and_si256(bits[0], isBoard[b]));
+            masks[1][b] = _mm256_or_si256(masks[1][b], _mm256_and_si256(bits[1], isBoard[b]));
+        }
+        current[0] = _mm256_or_si256(current[0], bits[0]);
+        current[1] = _mm256_or_si256(current[1], bits[1]);
+
+        __m256i activeOne = _mm256_and_si256(active, one);
+        filled = _mm256_add_epi32(filled, activeOne);
+        plies = _mm256_add_epi32(plies, activeOne);
+
+        // STATUS
+        __m256i mover = _mm256_blendv_epi8(current[0], current[1], side);
+        __m256i won = _mm256_and_si256(_mm256_i32gather_epi32(BATCH_PLAYOUT_TABLES.isWin, mover, 4), active);
+
+        __m256i boardBit = _mm256_sllv_epi32(one, board);
+        __m256i boardFull = _mm256_and_si256(_mm256_cmpeq_epi32(_mm256_or_si256(current[0], current[1]), full), active);
+        fullBoards = _mm256_or_si256(fullBoards, _mm256_and_si256(boardBit, boardFull));
+
+        // A board is dead once each of its lines holds a cell of both players.
+        __m256i blocked = _mm256_and_si256(_mm256_i32gather_epi32(BATCH_PLAYOUT_TABLES.lines, current[0], 4),
+                                           _mm256_i32gather_epi32(BATCH_PLAYOUT_TABLES.lines, current[1], 4));
+        __m256i boardDead = _mm256_and_si256(_mm256_cmpeq_epi32(blocked, _mm256_set1_epi32(BITBOARD_ALL_LINES)), active);
+        deadBoards = _mm256_or_si256(deadBoards, _mm256_and_si256(boardBit, boardDead));
+
+        __m256i over = _mm256_or_si256(_mm256_cmpeq_epi32(filled, allMoves), _mm256_cmpeq_epi32(deadBoards, full));
+        __m256i drawn = _mm256_andnot_si256(won, _mm256_and_si256(over, active));
+
+        // NEXT BOARD
+        __m256i targetFull = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_srlv_epi32(fullBoards, cell), one), one);
+        board = _mm256_blendv_epi8(cell, anyBoard, targetFull);
+        side = _mm256_xor_si256(side, active);
+
+        // FINISHED GAMES
+        __m256i finished = _mm256_or_si256(won, drawn);
+        if (_mm256_testz_si256(finished, finished))
+            continue;
+
+        // side was flipped above, so the winner of a won lane is the player now not to move.
+        int wonBits = _mm256_movemask_ps(_mm256_castsi256_ps(won));
+        int winnerTwo = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_andnot_si256(side, won)));
+        result.wins[1] += __builtin_popcount(winnerTwo);
+        result.wins[0] += __builtin_popcount(wonBits & ~winnerTwo);
+        result.draws += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(drawn)));
+
+        longest = _mm256_max_epi32(longest, _mm256_and_si256(plies, finished));
+        active = _mm256_andnot_si256(finished, active);
+
+        // Restart finished lanes from the start position while playouts are left.
+        int finishedBits = _mm256_movemask_ps(_mm256_castsi256_ps(finished));
+        int restartBits = 0;
+        for (int bits = finishedBits; bits && started < count; bits &= bits - 1, started++)
+            restartBits |= bits & -bits;
+
+        if (restartBits == 0)
+            continue;
+
+        __m256i restart = laneMask(restartBits);
+        for (int b = 0; b < POSITION_NUM_BOARDS; b++)
+        {
+            masks[0][b] = _mm256_blendv_epi8(masks[0][b], startMasks[0][b], restart);
+            masks[1][b] = _mm256_blendv_epi8(masks[1][b], startMasks[1][b], restart);
+        }
+        fullBoards = _mm256_blendv_epi8(fullBoards, startFull, restart);
+        deadBoards = _mm256_blendv_epi8(deadBoards, startDead, restart);
+        board = _mm256_blendv_epi8(board, startBoard, restart);
+        side = _mm256_blendv_epi8(side, startSide, restart);
+        filled = _mm256_blendv_epi8(filled, startFilled, restart);
+        plies = _mm256_andnot_si256(restart, plies);
+        active = _mm256_or_si256(active, restart);
+    }
+
+    int32_t lanes[BATCH_PLAYOUT_LANES];
+    _mm256_storeu_si256((__m256i *)lanes, longest);
+    for (int lane = 0; lane < BATCH_PLAYOUT_LANES; lane++)
+        result.maxPlies = std::max(result.maxPlies, (int)lanes[lane]);
+}
+
+#else
+
+/**
+ * @brief Plays the games one at a time.
+ *
+ * @param start The position to play from. Must be running.
+ * @param count The number of games, at least 1.
+ * @param policy How the games pick their moves.
+ * @param random The random stream to draw the moves from.
+ * @param result Adds up the totals.
+ */
+void BatchPlayout::playGames(const Position &start, int count, const PlayoutPolicy &policy, Random &random, BatchPlayoutResult &result)
+{
+    uint32_t threshold = HeavyPlayout::getThreshold(policy.epsilon);
+
+    for (int i = 0; i < count; i++)
+    {
+        Position position = start;
+        int plies = 0;
+
+        while (position.isRunning() && !position.isDead())
+        {
+            // Random redirect, draw the board like BoardManager::setRandomBoard().
+            if (position.board == POSITION_ANY_BOARD)
+                position.setBoard(random.pickBit(position.openBoards()));
+
+            if (policy.heavy)
+                position.play(position.board, HeavyPlayout::pickCell(position, random, threshold));
+            else
+                position.play(position.board, random.pickBit(position.emptyCells(position.board)));
+            plies++;
+        }
+
+        if (position.isRunning() || position.status == POSITION_DRAW)
+            result.draws++;
+        else
+            result.wins[Position::side(position.status)]++;
+
+        result.steps += plies;
+        result.maxPlies = std::max(result.maxPlies, plies);
+    }
+}
+
+#endif
+
+#endif
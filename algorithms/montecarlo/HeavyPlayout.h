@@ -0,0 +1,126 @@
+#ifndef HEAVY_PLAYOUT_H
+#define HEAVY_PLAYOUT_H
+
+#include "../../helpers/BitBoard.h"
+#include "../../helpers/Random.h"
+#include "../base/Position.h"
+#include "../base/Threats.h"
+#include "../heuristic/base/HeuristicTable.h"
+
+#include <cstdint>
+
+const int HEAVY_PLAYOUT_BLOCK_SHIFT = 9; // The blocking cells sit above the winning cells in a table entry.
+
+/**
+ * @brief The winning and blocking cells of every board, built once at startup.
+ *
+ * Indexed by BitBoard::ternaryIndex(own, enemy). The low 9 bits are the cells that win
+ * the board for "own" straight away, the next 9 bits the cells "enemy" would win with.
+ * Both come out of one lookup, where Threats::winningCells() takes two.
+ */
+struct HeavyPlayoutTables
+{
+    uint32_t threats[BITBOARD_NUM_STATES];
+    uint16_t corners; // HEURISTIC_CORNERS as a mask.
+
+    HeavyPlayoutTables()
+    {
+        this->corners = 0;
+        for (int i = 0; i < HEURISTIC_NUM_POSITIONS; i++)
+            this->corners |= (uint16_t)(1 << HEURISTIC_CORNERS[i]);
+
+        for (int own = 0; own < BITBOARD_NUM_MASKS; own++)
+        {
+            for (int enemy = 0; enemy < BITBOARD_NUM_MASKS; enemy++)
+            {
+                if (own & enemy)
+                    continue;
+
+                this->threats[BitBoard::ternaryIndex(own, enemy)] =
+                    Threats::winningCells(own, enemy) | (uint32_t)Threats::winningCells(enemy, own) << HEAVY_PLAYOUT_BLOCK_SHIFT;
+            }
+        }
+    }
+};
+
+const HeavyPlayoutTables HEAVY_PLAYOUT_TABLES;
+
+/**
+ * @brief One step of a heavy playout.
+ *
+ * Every rule is a table lookup or a few bit operations on the position's masks, so a
+ * step costs a few nanoseconds more than a random move.
+ */
+class HeavyPlayout
+{
+private:
+    static int pickBit(uint32_t mask, uint32_t draw);
+
+public:
+    static uint32_t getThreshold(double epsilon);
+    static int pickCell(const Position &position, Random &random, uint32_t threshold);
+};
+
+/**
+ * @brief Turns epsilon into the 32 bit draw below which a step plays at random.
+ */
+uint32_t HeavyPlayout::getThreshold(double epsilon)
+{
+    if (epsilon <= 0)
+        return 0;
+    if (epsilon >= 1)
+        return 0xFFFFFFFF;
+
+    return (uint32_t)(epsilon * 4294967296.0);
+}
+
+/**
+ * @brief Picks one of the set bits of a mask with 32 random bits, like Random::pickBit().
+ */
+int HeavyPlayout::pickBit(uint32_t mask, uint32_t draw)
+{
+    return BitBoard::nthSetBit(mask, (int)(((uint64_t)draw * BitBoard::popCount(mask)) >> 32));
+}
+
+/**
+ * @brief Picks the cell to play on the current board.
+ *
+ * @param position The position. Its board must not be POSITION_ANY_BOARD.
+ * @param random The random stream of the playout, one draw per step.
+ * @param threshold The draw below which the move is random, see getThreshold().
+ * @return The cell (row * 3 + col).
+ */
+int HeavyPlayout::pickCell(const Position &position, Random &random, uint32_t threshold)
+{
+    const uint32_t *threats = HEAVY_PLAYOUT_TABLES.threats;
+    int board = position.board;
+    int own = Position::side(position.toMove);
+    uint16_t empty = position.emptyCells(board);
+    uint64_t draw = random.next();
+
+    if ((uint32_t)draw < threshold)
+        return pickBit(empty, (uint32_t)(draw >> 32));
+
+    // WIN, else BLOCK
+    uint32_t current = threats[BitBoard::ternaryIndex(position.masks[own][board], position.masks[1 - own][board])];
+    if (current & BITBOARD_FULL)
+        return pickBit(current & BITBOARD_FULL, (uint32_t)(draw >> 32));
+    if (current >> HEAVY_PLAYOUT_BLOCK_SHIFT)
+        return pickBit(current >> HEAVY_PLAYOUT_BLOCK_SHIFT, (uint32_t)(draw >> 32));
+
+    // CENTRE > CORNERS > CROSS, as weights 3, 2 and 1.
+    uint16_t good = empty & (HEAVY_PLAYOUT_TABLES.corners | 1 << HEURISTIC_CENTRE);
+    uint16_t best = empty & 1 << HEURISTIC_CENTRE;
+    int total = BitBoard::popCount(empty) + BitBoard::popCount(good) + BitBoard::popCount(best);
+    int n = (int)(((draw >> 32) * total) >> 32);
+
+    if (n < BitBoard::popCount(empty))
+        return BitBoard::nthSetBit(empty, n);
+    n -= BitBoard::popCount(empty);
+    if (n < BitBoard::popCount(good))
+        return BitBoard::nthSetBit(good, n);
+
+    return HEURISTIC_CENTRE;
+}
+
+#endif
@@ -0,0 +1,1052 @@
+#ifndef MCTS_H
+#define MCTS_H
+
+#include "../../TicTacToe.h"
+#include "../../helpers/BitBoard.h"
+#include "../../helpers/ThreadPool.h"
+#include "../../struct/Coordinate.h"
+#include "../base/Algorithm.h"
+#include "../base/Position.h"
+#include "../base/Threats.h"
+#include "./HeavyPlayout.h"
+#include "./MCTSArena.h"
+#include "./PolicyPrior.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+const int MCTS_DEFAULT_PLAYOUTS = 10000;
+const double MCTS_EXPLORATION = 1.4;
+const uint32_t MCTS_WIN_SCORE = 2;
+const uint32_t MCTS_DRAW_SCORE = 1;
+const uint32_t MCTS_BUDGET_MAX_NODES = 1 << 18; // Largest tree for a budget, about 80 MB.
+const int MCTS_CLOCK_INTERVAL = 16;            // Playouts between clock reads.
+const double MCTS_RAVE_EQUIVALENCE = 300;      // Visits at which the real and AMAF values weigh about the same.
+const double MCTS_RAVE_EXPLORATION = 0.4;      // UCB1 constant when RAVE guides the search.
+const double MCTS_PRUNE_KEEP = 0.5;            // Share of the nodes a prune keeps.
+const double MCTS_PUCT_EXPLORATION = 0.75;     // Weight of the prior term in PUCT.
+
+// How a node picks the move to descend.
+const int MCTS_UCB = 0;  // UCB1: every move is tried once, then the best upper bound.
+const int MCTS_PUCT = 1; // PUCT: the exploration of each move is scaled by its prior.
+
+/**
+ * @brief The edges one playout took through the tree, the nodes they join and who played each of them.
+ */
+struct MCTSPath
+{
+    uint32_t nodes[POSITION_NUM_MOVES];
+    uint32_t edges[POSITION_NUM_MOVES];
+    uint32_t children[POSITION_NUM_MOVES]; // Node each edge led to, MCTS_NONE if the pool was full.
+    int8_t movers[POSITION_NUM_MOVES];
+    int length;
+};
+
+/**
+ * @brief Everything one thread of the search writes to besides the shared tree.
+ *
+ * Aligned to a cache line, so two workers never write to the same one.
+ */
+struct alignas(64) MCTSWorker
+{
+    Random random;
+    long long playouts;
+    long long nodes;
+    int maxDepth;
+    bool waiting; // Stopped for the full tree to be pruned.
+};
+
+/**
+ * @brief UCT Monte Carlo Tree Search.
+ *
+ * Every playout walks down the tree picking moves with PUCT, adds one new node, plays
+ * the rest of the game at random and backs the result up the path. Unlike the flat
+ * MonteCarlo algorithm the playouts concentrate on the promising moves.
+ *
+ * PUCT (the default) gives each move a prior from PolicyPrior when its node is expanded
+ * and scales the move's exploration by it, so from the first visit the search spends its
+ * playouts on moves that take the centre, win or block, and skips those that hand the
+ * enemy a board. setSelection(MCTS_UCB) goes back to UCB1, which tries every move once.
+ *
+ * When a move points to a full board the next board is random. Nodes for these
+ * positions hold the moves of every open board, and each descent draws the board first
+ * and then picks among that board's moves.
+ *
+ * With several threads the search is tree parallel: all threads descend the same tree.
+ * A move's visit is counted on the way down with no score (a virtual loss), so other
+ * threads see it as worse and spread out to other branches until the result comes back.
+ * Counters are atomic, new nodes are linked in with a compare and swap and a node is
+ * expanded under its own spinlock, so there is no global lock.
+ *
+ * With RAVE on (the default) every edge also keeps all-moves-as-first statistics: a
+ * playout through a node counts for each of its moves that the same player made at any
+ * later point of the game. A cell is worth much the same whatever the move order, so
+ * these fill up far faster than the real statistics. Selection blends the two, leaning
+ * on the AMAF value while a move has few visits and on its own value as they grow.
+ *
+ * In graph mode the tree becomes a DAG: a position-hash table in the arena gives each
+ * position one node whatever the move order, and moves read their value from the node
+ * they lead to, so transpositions pool their statistics. Each move keeps its own visit
+ * count for exploration.
+ *
+ * The search is also a solver (MCTS-Solver). A move that ends the game, or that lets
+ * the enemy complete a line straight away, is proven on the spot, and proofs travel
+ * up the tree: a position is lost for the player who moved into it once the player to
+ * move has a proven win on every board they can be sent to, and won once every move
+ * loses. Proven moves get no more playouts: selection takes a proven win and skips
+ * proven losses, and a descent reaching a proven move backs its result up without
+ * playing out. The search stops as soon as the root is solved and plays the proven win.
+ *
+ * The tree is kept from one move to the next. When the grid differs from the last root
+ * by our move and the opponent's reply, the search carries on from the subtree under
+ * those two moves and the rest of the arena is freed.
+ *
+ * The arena caps the memory of the tree, see setMemoryLimit(). When it fills up the
+ * threads stop, the least visited subtrees are pruned and their slots recycled, and the
+ * search carries on with the budget that is left.
+ */
+class MCTS : public Algorithm
+{
+private:
+    SearchBudget budget;
+    PlayoutPolicy policy;
+    uint32_t randomThreshold; // HeavyPlayout::getThreshold() of the policy's epsilon.
+    int selection;
+    bool rave;
+    bool graph;
+    bool reuse;
+    bool hasTree;       // The arena holds the tree of the last search.
+    Position treeRoot;  // The position at the root of that tree.
+    uint32_t rootIndex; // The node of that position.
+    size_t memoryLimit; // Bytes for the tree, 0 for the budget's size alone.
+    bool pruning;       // The threads stop for a prune when the tree fills up.
+    MCTSArena arena;
+    unique_ptr<ThreadPool> pool;
+    vector<MCTSWorker> workers;
+
+    // PRIVATE METHODS
+    uint32_t getTreeSize() const;
+    void resizeArena();
+    uint32_t findSubtree(const Position &rootPosition);
+    uint32_t linkChild(MCTSEdge &edge, const Position &position, bool &fresh);
+    void runWorker(int worker, const Position &rootPosition, uint32_t root);
+    void runPlayout(const Position &rootPosition, uint32_t root, MCTSWorker &worker);
+    bool expand(uint32_t index, const Position &position);
+    uint32_t selectEdge(uint32_t index, const Position &position);
+    int playOut(Position &position, MCTSWorker &worker);
+    void backPropagate(const MCTSPath &path, const Position &end, int winner);
+    void propagateProof(const MCTSPath &path);
+    uint8_t getProof(uint32_t index, int board);
+    uint8_t getLeafProof(const Position &position);
+    double getMean(const MCTSEdge &edge, uint32_t visits);
+    int randomOpenBoard(const Position &position, Random &random);
+
+public:
+    /**
+     * @brief Constructs an MCTS object.
+     *
+     * @param grid The initial grid of the Tic-Tac-Toe game.
+     * @param player The player making the moves (1 or -1).
+     * @param numPlayouts The number of playouts per move.
+     * @param numThreads The number of threads searching the tree.
+     */
+    MCTS(TicTacToe (*grid)[3][3], int player, int numPlayouts = MCTS_DEFAULT_PLAYOUTS, int numThreads = 1)
+        : Algorithm(grid, player),
+          budget(numPlayouts, 0),
+          randomThreshold(HeavyPlayout::getThreshold(PlayoutPolicy().epsilon)),
+          selection(MCTS_PUCT),
+          rave(true),
+          graph(false),
+          reuse(true),
+          hasTree(false),
+          rootIndex(MCTS_NONE),
+          memoryLimit(0),
+          pruning(true),
+          arena(2 * (uint32_t)numPlayouts + 1)
+    {
+        setNumThreads(numThreads);
+    }
+
+    void useAlgorithm(int *x, int *y, const Coordinate *currentBoard);
+    string getName() const override;
+    void setNumThreads(int numThreads) override;
+    void setBudget(const SearchBudget &budget) override;
+    void setPlayoutPolicy(const PlayoutPolicy &policy) override;
+
+    /**
+     * @brief Chooses how a node picks the move to descend.
+     *
+     * @param selection MCTS_UCB or MCTS_PUCT.
+     */
+    void setSelection(int selection)
+    {
+        this->selection = selection;
+    }
+
+    /**
+     * @brief Turns the RAVE statistics on or off.
+     */
+    void setRave(bool rave)
+    {
+        this->rave = rave;
+    }
+
+    /**
+     * @brief Turns graph search on or off. Drops the tree.
+     */
+    void setGraph(bool graph)
+    {
+        this->graph = graph;
+        this->hasTree = false;
+        this->arena.setTable(graph);
+        if (this->memoryLimit > 0)
+            resizeArena();
+    }
+
+    /**
+     * @brief Caps the memory of the tree. Drops the tree.
+     *
+     * @param bytes The most the tree may take, 0 to size it by the budget alone.
+     */
+    void setMemoryLimit(size_t bytes) override
+    {
+        this->memoryLimit = bytes;
+        this->hasTree = false;
+        resizeArena();
+    }
+
+    /**
+     * @brief Turns keeping the tree between moves on or off.
+     */
+    void setReuse(bool reuse)
+    {
+        this->reuse = reuse;
+        this->hasTree = false;
+    }
+
+    /**
+     * @brief The number of nodes in the tree of the last search.
+     */
+    uint32_t getTreeNodes() const
+    {
+        return this->arena.getNodeCount();
+    }
+};
+
+/**
+ * @brief Searches the current position and picks the most visited move.
+ *
+ * @param x Pointer to store the x-coordinate of the best move.
+ * @param y Pointer to store the y-coordinate of the best move.
+ * @param currentBoard The board the move must be played on.
+ */
+void MCTS::useAlgorithm(int *x, int *y, const Coordinate *currentBoard)
+{
+    beginSearch();
+
+    // Opening moves come from the book when one is open.
+    if (playBookMove(x, y, currentBoard))
+    {
+        endSearch(*x, *y);
+        return;
+    }
+
+    Position rootPosition = Position::fromGrid(this->grid, currentBoard, this->player);
+    uint64_t seed = this->random.next();
+
+    // Carry on from the last tree if the game went through it, else start a new one.
+    uint32_t root = this->hasTree ? findSubtree(rootPosition) : MCTS_NONE;
+    if (root != MCTS_NONE)
+    {
+        root = this->arena.keepSubtree(root);
+        this->stats.cacheHits += this->arena.getNodeCount();
+    }
+    else
+    {
+        this->arena.reset();
+        root = this->arena.allocateNode();
+        this->arena.node(root).key = rootPosition.hash;
+    }
+
+    this->hasTree = this->reuse;
+    this->treeRoot = rootPosition;
+    this->rootIndex = root;
+
+    for (size_t i = 0; i < this->workers.size(); i++)
+    {
+        this->workers[i].random.seed(seed + i);
+        this->workers[i].playouts = 0;
+        this->workers[i].nodes = 0;
+        this->workers[i].maxDepth = 0;
+    }
+
+    // Search until the budget is used up, pruning whenever the tree fills up on the way.
+    // A tree too small to prune stops growing instead.
+    this->pruning = true;
+    while (true)
+    {
+        if (this->pool)
+            this->pool->run([this, &rootPosition, root](int worker)
+                            { runWorker(worker, rootPosition, root); });
+        else
+            runWorker(0, rootPosition, root);
+
+        bool waiting = false;
+        for (size_t i = 0; i < this->workers.size(); i++)
+            waiting = waiting || this->workers[i].waiting;
+
+        if (!waiting)
+            break;
+
+        uint32_t keep = (uint32_t)(this->arena.getNodeCount() * MCTS_PRUNE_KEEP);
+        if (this->arena.prune(root, keep) == 0)
+            this->pruning = false;
+    }
+
+    // A proven win is played straight away. Otherwise the most visited root move that
+    // isn't proven lost is the most reliable one. A root kept from a random redirect
+    // holds the moves of every board, only the drawn one counts.
+    MCTSNode &rootNode = this->arena.node(root);
+    int bestMove = -1;
+    uint32_t bestVisits = 0, bestScore = 0;
+    bool bestLost = false;
+
+    if (rootNode.state.load(memory_order_acquire) == MCTS_EXPANDED)
+    {
+        for (uint32_t i = 0; i < rootNode.numEdges; i++)
+        {
+            MCTSEdge &edge = this->arena.edge(rootNode.firstEdge + i);
+            if (edge.move / 9 != rootPosition.board)
+                continue;
+
+            uint8_t proof = edge.proof.load(memory_order_relaxed);
+            if (proof == MCTS_PROVEN_WIN)
+            {
+                bestMove = edge.move;
+                break;
+            }
+
+            uint32_t visits = edge.visits.load(memory_order_relaxed);
+            uint32_t score = edge.score.load(memory_order_relaxed);
+            bool lost = proof == MCTS_PROVEN_LOSS;
+
+            if (bestMove == -1 || (bestLost && !lost) ||
+                (lost == bestLost && (visits > bestVisits || (visits == bestVisits && score > bestScore))))
+            {
+                bestMove = edge.move;
+                bestVisits = visits;
+                bestScore = score;
+                bestLost = lost;
+            }
+        }
+    }
+
+    // No room for the root's edges, take any empty cell.
+    if (bestMove == -1)
+    {
+        uint16_t empty = rootPosition.emptyCells(rootPosition.board);
+        bestMove = rootPosition.board * 9 + BitBoard::lowestBit(empty);
+    }
+
+    int cell = bestMove % 9;
+    *x = cell / BOARD_SIZE;
+    *y = cell % BOARD_SIZE;
+
+    // Merge the counters of the workers
+    for (size_t i = 0; i < this->workers.size(); i++)
+    {
+        this->stats.playouts += this->workers[i].playouts;
+        this->stats.leafEvals += this->workers[i].playouts;
+        this->stats.nodes += this->workers[i].nodes;
+        this->stats.maxDepth = std::max(this->stats.maxDepth, this->workers[i].maxDepth);
+    }
+
+    this->stats.nodes += this->arena.getNodeCount();
+    endSearch(*x, *y);
+}
+
+string MCTS::getName() const
+{
+    return "MCTS";
+}
+
+/**
+ * @brief Sets the number of threads. The threads are started here, not on every move.
+ *
+ * @param numThreads The number of threads, 0 for one per hardware thread.
+ */
+void MCTS::setNumThreads(int numThreads)
+{
+    if (numThreads < 1)
+        numThreads = ThreadPool::defaultNumThreads();
+
+    this->pool.reset(numThreads > 1 ? new ThreadPool(numThreads) : nullptr);
+    this->workers.assign(numThreads, MCTSWorker());
+}
+
+/**
+ * @brief Searches every move until the budget is used up instead of a fixed playout count.
+ *
+ * The tree has room for a node per playout of the playout budget, twice over so a kept
+ * subtree doesn't crowd out the new playouts, up to MCTS_BUDGET_MAX_NODES nodes (also
+ * the size used for a time budget alone), or fewer under a memory limit. Once those are
+ * used the least visited subtrees are pruned to make room.
+ *
+ * @param budget The budget per move.
+ */
+void MCTS::setBudget(const SearchBudget &budget)
+{
+    this->budget = budget;
+    this->hasTree = false;
+    resizeArena();
+}
+
+/**
+ * @brief Switches the playouts between random and heavy moves.
+ *
+ * @param policy The playout policy.
+ */
+void MCTS::setPlayoutPolicy(const PlayoutPolicy &policy)
+{
+    this->policy = policy;
+    this->randomThreshold = HeavyPlayout::getThreshold(policy.epsilon);
+}
+
+/**
+ * @brief The number of nodes the budget calls for.
+ */
+uint32_t MCTS::getTreeSize() const
+{
+    bool fits = this->budget.playouts > 0 && 2 * this->budget.playouts < MCTS_BUDGET_MAX_NODES;
+    return fits ? 2 * (uint32_t)this->budget.playouts + 1 : MCTS_BUDGET_MAX_NODES;
+}
+
+/**
+ * @brief Sizes the arena for the budget, within the memory limit. Drops the tree.
+ */
+void MCTS::resizeArena()
+{
+    uint32_t maxNodes = getTreeSize();
+
+    if (this->memoryLimit > 0)
+        maxNodes = std::min(maxNodes, std::max(MCTSArena::getCapacity(this->memoryLimit, this->graph), (uint32_t)1));
+
+    this->arena.resize(maxNodes);
+}
+
+/**
+ * @brief Finds the node of the last tree that the game has reached since.
+ *
+ * That is the case when the grid only gained our move from the last root and one
+ * opponent reply. A board drawn after a redirect is fine, the node holds every board.
+ *
+ * @param rootPosition The position to search now.
+ * @return The node, or MCTS_NONE if the game left the tree.
+ */
+uint32_t MCTS::findSubtree(const Position &rootPosition)
+{
+    const Position &last = this->treeRoot;
+    int moves[2] = {-1, -1}; // Indexed by Position::side()
+
+    if (last.toMove != rootPosition.toMove || last.filled + 2 != rootPosition.filled)
+        return MCTS_NONE;
+
+    for (int side = 0; side < 2; side++)
+    {
+        for (int b = 0; b < POSITION_NUM_BOARDS; b++)
+        {
+            uint16_t added = rootPosition.masks[side][b] & ~last.masks[side][b];
+            if ((last.masks[side][b] & ~rootPosition.masks[side][b]) != 0)
+                return MCTS_NONE;
+            if (added == 0)
+                continue;
+            if (moves[side] != -1 || BitBoard::popCount(added) != 1)
+                return MCTS_NONE;
+
+            moves[side] = b * 9 + BitBoard::lowestBit(added);
+        }
+    }
+
+    // Our move, then the reply.
+    int path[2] = {moves[Position::side(last.toMove)], moves[Position::side(-last.toMove)]};
+    uint32_t index = this->rootIndex;
+
+    for (int ply = 0; ply < 2 && index != MCTS_NONE; ply++)
+    {
+        MCTSNode &node = this->arena.node(index);
+        if (path[ply] == -1 || node.state.load(memory_order_acquire) != MCTS_EXPANDED)
+            return MCTS_NONE;
+
+        uint32_t next = MCTS_NONE;
+        for (uint32_t i = node.firstEdge; i < node.firstEdge + node.numEdges; i++)
+            if (this->arena.edge(i).move == path[ply])
+                next = this->arena.edge(i).child.load(memory_order_acquire);
+
+        index = next;
+    }
+
+    return index;
+}
+
+/**
+ * @brief Runs one thread's share of the playouts on the shared tree.
+ *
+ * The worker stops early, with waiting set, when the tree is full and should be pruned.
+ * It picks up where it left off on the next call.
+ *
+ * @param worker The index of the worker.
+ * @param rootPosition The position at the root of the tree.
+ * @param root The root node.
+ */
+void MCTS::runWorker(int worker, const Position &rootPosition, uint32_t root)
+{
+    MCTSWorker &slot = this->workers[worker];
+    int numWorkers = (int)this->workers.size();
+
+    slot.waiting = false;
+
+    // Worker w takes playouts [N * w / T, N * (w + 1) / T) of the budget
+    SearchBudget share = this->budget;
+    if (share.playouts > 0)
+    {
+        share.playouts = this->budget.playouts * (worker + 1) / numWorkers - this->budget.playouts * worker / numWorkers;
+        if (share.playouts == 0)
+            return;
+    }
+
+    // Play at least once, then until the budget is used up or the root is solved. The
+    // clock is read every few playouts.
+    double elapsedMs = slot.playouts > 0 ? getElapsedMs() : 0;
+    while (slot.playouts == 0 || !share.isExhausted(slot.playouts, elapsedMs))
+    {
+        if (getProof(root, rootPosition.board) != MCTS_UNPROVEN)
+            return;
+
+        if (this->pruning && this->arena.isFull())
+        {
+            slot.waiting = true;
+            return;
+        }
+
+        runPlayout(rootPosition, root, slot);
+
+        if (slot.playouts % MCTS_CLOCK_INTERVAL == 0)
+            elapsedMs = getElapsedMs();
+    }
+}
+
+/**
+ * @brief Runs one selection, expansion, simulation and backpropagation.
+ *
+ * @param rootPosition The position at the root of the tree.
+ * @param root The root node.
+ * @param worker The worker running the playout.
+ */
+void MCTS::runPlayout(const Position &rootPosition, uint32_t root, MCTSWorker &worker)
+{
+    Position position = rootPosition;
+    MCTSPath path;
+    uint32_t index = root;
+    int winner = POSITION_RUNNING;
+
+    path.length = 0;
+
+    this->arena.node(root).visits.fetch_add(1, memory_order_relaxed);
+
+    // SELECTION
+    // Walk down while the nodes are expanded, stopping at the first new node.
+    while (position.isRunning() && index != MCTS_NONE)
+    {
+        // EXPANSION
+        // A node gets its edges the first time a playout passes through it.
+        if (!expand(index, position))
+            break;
+
+        // Random redirect, draw the board before choosing the move.
+        if (position.board == POSITION_ANY_BOARD)
+            position.setBoard(randomOpenBoard(position, worker.random));
+
+        uint32_t edgeIndex = selectEdge(index, position);
+        MCTSEdge &edge = this->arena.edge(edgeIndex);
+
+        // Virtual loss: the visit counts now, the score only once the playout is over.
+        edge.visits.fetch_add(1, memory_order_relaxed);
+
+        int8_t mover = position.toMove;
+        position.play(edge.move / 9, edge.move % 9);
+
+        bool fresh = false;
+        uint32_t child = edge.child.load(memory_order_acquire);
+        if (child == MCTS_NONE)
+            child = linkChild(edge, position, fresh);
+
+        if (child != MCTS_NONE)
+        {
+            MCTSNode &childNode = this->arena.node(child);
+            childNode.visits.fetch_add(1, memory_order_relaxed);
+            if (fresh)
+                childNode.proof.store(getLeafProof(position), memory_order_relaxed);
+        }
+
+        path.nodes[path.length] = index;
+        path.edges[path.length] = edgeIndex;
+        path.children[path.length] = child;
+        path.movers[path.length] = mover;
+        path.length++;
+
+        // A proven move needs no playout, its result is known.
+        uint8_t proof = edge.proof.load(memory_order_relaxed);
+        if (proof == MCTS_UNPROVEN && child != MCTS_NONE)
+        {
+            proof = this->arena.node(child).proof.load(memory_order_relaxed);
+            if (proof != MCTS_UNPROVEN)
+                edge.proof.store(proof, memory_order_relaxed);
+        }
+
+        if (proof != MCTS_UNPROVEN)
+        {
+            winner = proof == MCTS_PROVEN_WIN ? mover : -mover;
+            break;
+        }
+
+        // Simulate from a new node.
+        if (fresh)
+            break;
+
+        index = child;
+    }
+
+    worker.maxDepth = std::max(worker.maxDepth, path.length);
+
+    // SIMULATION
+    bool solved = winner != POSITION_RUNNING;
+    if (solved)
+        worker.playouts++;
+    else
+        winner = playOut(position, worker);
+
+    // BACKPROPAGATION
+    backPropagate(path, position, winner);
+    if (solved)
+        propagateProof(path);
+}
+
+/**
+ * @brief Gives a move its child node the first time the move is taken.
+ *
+ * In graph mode the position may already have a node, reached by another move order,
+ * and the move shares it. Otherwise a new node is made. Another thread may link the
+ * move first; its node is then used and any spare one is left unused.
+ *
+ * @param edge The move.
+ * @param position The position after the move.
+ * @param fresh Set if the node is new, the descent then stops there.
+ * @return The child node, or MCTS_NONE if the node pool is full.
+ */
+uint32_t MCTS::linkChild(MCTSEdge &edge, const Position &position, bool &fresh)
+{
+    uint32_t child = this->graph ? this->arena.findNode(position.hash) : MCTS_NONE;
+
+    if (child == MCTS_NONE)
+    {
+        child = this->arena.allocateNode();
+        if (child == MCTS_NONE)
+            return MCTS_NONE;
+
+        this->arena.node(child).key = position.hash;
+        fresh = true;
+
+        // Another thread may have made a node for the position meanwhile.
+        uint32_t owner = this->graph ? this->arena.insertNode(position.hash, child) : child;
+        if (owner != MCTS_NONE && owner != child)
+        {
+            child = owner;
+            fresh = false;
+        }
+    }
+
+    uint32_t linked = MCTS_NONE;
+    if (!edge.child.compare_exchange_strong(linked, child, memory_order_acq_rel, memory_order_acquire))
+    {
+        child = linked;
+        fresh = false;
+    }
+
+    return child;
+}
+
+/**
+ * @brief Makes sure a node has its edges, one per legal move.
+ *
+ * The first thread to get here takes the node's spinlock and expands it. Any other
+ * thread waits for it, which is only ever a few dozen stores.
+ *
+ * @return `false` if the edge pool is full, the node then stays a leaf.
+ */
+bool MCTS::expand(uint32_t index, const Position &position)
+{
+    MCTSNode &node = this->arena.node(index);
+    uint8_t state = node.state.load(memory_order_acquire);
+
+    if (state == MCTS_EXPANDED)
+        return true;
+
+    if (state == MCTS_UNEXPANDED &&
+        node.state.compare_exchange_strong(state, MCTS_EXPANDING, memory_order_acquire, memory_order_acquire))
+    {
+        uint8_t moves[POSITION_NUM_MOVES];
+        float priors[POSITION_NUM_MOVES];
+        int count = position.legalMoves(moves);
+        if (this->selection == MCTS_PUCT)
+            PolicyPrior::getPriors(position, moves, count, priors);
+
+        uint32_t first = this->arena.allocateEdges(count);
+        if (first == MCTS_NONE)
+        {
+            node.state.store(MCTS_LEAF, memory_order_release);
+            return false;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            MCTSEdge &edge = this->arena.edge(first + i);
+            edge.child.store(MCTS_NONE, memory_order_relaxed);
+            edge.visits.store(0, memory_order_relaxed);
+            edge.score.store(0, memory_order_relaxed);
+            edge.rave.store(0, memory_order_relaxed);
+            edge.prior = this->selection == MCTS_PUCT ? priors[i] : 0.0f;
+            edge.move = moves[i];
+            edge.proof.store(MCTS_UNPROVEN, memory_order_relaxed);
+        }
+
+        node.firstEdge = first;
+        node.numEdges = (uint8_t)count;
+        node.state.store(MCTS_EXPANDED, memory_order_release);
+
+        return true;
+    }
+
+    // Someone else is expanding the node, wait until its edges are published.
+    while ((state = node.state.load(memory_order_acquire)) == MCTS_EXPANDING)
+        this_thread::yield();
+
+    return state == MCTS_EXPANDED;
+}
+
+/**
+ * @brief Picks the edge with the highest UCB1 or PUCT value on the current board.
+ *
+ * With UCB1, unvisited moves are tried first; with RAVE on, the one with the best AMAF
+ * value. PUCT ranks visited and unvisited moves together, by
+ * mean + c * prior * sqrt(max(N, 1)) / (1 + n), so a move the prior dislikes may never be
+ * tried. N is counted as 1 at a new node, so the prior picks its first move too.
+ * Either way a proven win is taken at once and proven losses only when nothing else is left.
+ */
+uint32_t MCTS::selectEdge(uint32_t index, const Position &position)
+{
+    MCTSNode &node = this->arena.node(index);
+    uint32_t first = node.firstEdge;
+    uint32_t last = first + node.numEdges;
+    bool puct = this->selection == MCTS_PUCT;
+
+    // Redirect nodes hold the moves of every board, narrow them down to the drawn one.
+    uint32_t parentVisits = 0;
+    double bestValue = -1.0;
+    uint32_t best = MCTS_NONE;
+    uint32_t lost = MCTS_NONE;
+
+    for (uint32_t i = first; i < last; i++)
+    {
+        MCTSEdge &edge = this->arena.edge(i);
+        if (edge.move / 9 != position.board)
+            continue;
+
+        uint32_t visits = edge.visits.load(memory_order_relaxed);
+        uint8_t proof = edge.proof.load(memory_order_relaxed);
+        if (proof == MCTS_PROVEN_WIN)
+            return i;
+        if (proof == MCTS_PROVEN_LOSS)
+        {
+            lost = i;
+            parentVisits += visits;
+            continue;
+        }
+
+        if (visits == 0 && !puct)
+        {
+            if (!this->rave)
+                return i;
+
+            double value = getMean(edge, 0);
+            if (value > bestValue)
+            {
+                bestValue = value;
+                best = i;
+            }
+        }
+
+        parentVisits += visits;
+    }
+
+    if (best != MCTS_NONE)
+        return best;
+
+    double logVisits = log((double)parentVisits);
+    double sqrtVisits = sqrt((double)max(parentVisits, 1u));
+    double exploration = this->rave ? MCTS_RAVE_EXPLORATION : MCTS_EXPLORATION;
+
+    for (uint32_t i = first; i < last; i++)
+    {
+        MCTSEdge &edge = this->arena.edge(i);
+        if (edge.move / 9 != position.board || edge.proof.load(memory_order_relaxed) == MCTS_PROVEN_LOSS)
+            continue;
+
+        uint32_t visits = edge.visits.load(memory_order_relaxed);
+        double value = getMean(edge, visits);
+        if (puct)
+            value += MCTS_PUCT_EXPLORATION * edge.prior * sqrtVisits / (1.0 + visits);
+        else
+            value += exploration * sqrt(logVisits / visits);
+
+        if (value > bestValue)
+        {
+            bestValue = value;
+            best = i;
+        }
+    }
+
+    return best != MCTS_NONE ? best : lost;
+}
+
+/**
+ * @brief The mean score of an edge, blended with its AMAF value when RAVE is on.
+ *
+ * The AMAF weight is beta = sqrt(k / (3n + k)) for n visits, with k = MCTS_RAVE_EQUIVALENCE,
+ * so it starts at 1 and fades out as the move's own statistics build up. A move with no
+ * statistics at all counts as a draw.
+ *
+ * @param edge The edge.
+ * @param visits The visits of the edge, 0 to rank an unvisited move by AMAF alone.
+ */
+double MCTS::getMean(const MCTSEdge &edge, uint32_t visits)
+{
+    double mean = visits > 0 ? edge.score.load(memory_order_relaxed) / (2.0 * visits) : 0.5;
+
+    // In a graph the value of the position is shared by every move order reaching it.
+    uint32_t child = this->graph ? edge.child.load(memory_order_relaxed) : MCTS_NONE;
+    if (child != MCTS_NONE)
+    {
+        MCTSNode &node = this->arena.node(child);
+        uint32_t nodeVisits = node.visits.load(memory_order_relaxed);
+        if (nodeVisits > 0)
+            mean = node.score.load(memory_order_relaxed) / (2.0 * nodeVisits);
+    }
+
+    if (!this->rave)
+        return mean;
+
+    uint64_t rave = edge.rave.load(memory_order_relaxed);
+    uint32_t raveVisits = (uint32_t)(rave >> 32);
+    double raveMean = raveVisits > 0 ? (uint32_t)rave / (2.0 * raveVisits) : 0.5;
+
+    if (visits == 0)
+        return raveMean;
+
+    double beta = sqrt(MCTS_RAVE_EQUIVALENCE / (3.0 * visits + MCTS_RAVE_EQUIVALENCE));
+    return (1.0 - beta) * mean + beta * raveMean;
+}
+
+/**
+ * @brief Plays random or heavy moves until the result of the game is forced.
+ *
+ * @return The winner (1 or -1), or POSITION_DRAW.
+ */
+int MCTS::playOut(Position &position, MCTSWorker &worker)
+{
+    while (position.isRunning())
+    {
+        if (position.isDead())
+        {
+            position.status = POSITION_DRAW;
+            break;
+        }
+
+        if (position.board == POSITION_ANY_BOARD)
+            position.setBoard(randomOpenBoard(position, worker.random));
+
+        // A line the mover can complete decides the game, whatever move would be drawn.
+        // It is still played so RAVE credits the winning cell.
+        int own = Position::side(position.toMove);
+        uint16_t ownCells = position.masks[own][position.board];
+        uint16_t enemyCells = position.masks[1 - own][position.board];
+        if (BitBoard::canWin(ownCells, enemyCells))
+        {
+            position.play(position.board, BitBoard::lowestBit(Threats::winningCells(ownCells, enemyCells)));
+            worker.nodes++;
+            break;
+        }
+
+        int cell;
+        if (this->policy.heavy)
+            cell = HeavyPlayout::pickCell(position, worker.random, this->randomThreshold);
+        else
+            cell = worker.random.pickBit(position.emptyCells(position.board));
+
+        position.play(position.board, cell);
+        worker.nodes++;
+    }
+
+    worker.playouts++;
+
+    return position.status;
+}
+
+/**
+ * @brief Adds the result of a playout to every edge on its path.
+ *
+ * The visits were already counted on the way down. With RAVE on, every move of a node on
+ * the path that its mover made later in the game gets an AMAF visit too. A cell can only
+ * be taken once, so those are exactly the moves whose cell the mover holds at the end.
+ *
+ * @param path The path of the playout.
+ * @param end The position the playout ended in.
+ * @param winner The winner (1 or -1), or POSITION_DRAW.
+ */
+void MCTS::backPropagate(const MCTSPath &path, const Position &end, int winner)
+{
+    for (int i = 0; i < path.length; i++)
+    {
+        MCTSEdge &edge = this->arena.edge(path.edges[i]);
+        uint32_t score = winner == path.movers[i] ? MCTS_WIN_SCORE : (winner == POSITION_DRAW ? MCTS_DRAW_SCORE : 0);
+
+        if (score > 0)
+        {
+            edge.score.fetch_add(score, memory_order_relaxed);
+            if (this->graph && path.children[i] != MCTS_NONE)
+                this->arena.node(path.children[i]).score.fetch_add(score, memory_order_relaxed);
+        }
+
+        if (!this->rave)
+            continue;
+
+        MCTSNode &node = this->arena.node(path.nodes[i]);
+        const uint16_t *held = end.masks[Position::side(path.movers[i])];
+        uint64_t update = (1ULL << 32) | score;
+
+        for (uint32_t j = node.firstEdge; j < node.firstEdge + node.numEdges; j++)
+        {
+            MCTSEdge &sibling = this->arena.edge(j);
+            if (held[sibling.move / 9] & (1 << (sibling.move % 9)))
+                sibling.rave.fetch_add(update, memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * @brief Carries the proof of a playout's last move up its path.
+ *
+ * Each node on the way is checked with getProof(), and the climb stops at the first
+ * one that is still open.
+ *
+ * @param path The path of the playout. Its last edge must be proven.
+ */
+void MCTS::propagateProof(const MCTSPath &path)
+{
+    for (int i = path.length - 1; i >= 0; i--)
+    {
+        uint8_t proof = getProof(path.nodes[i], POSITION_ANY_BOARD);
+        if (proof == MCTS_UNPROVEN)
+            return;
+
+        this->arena.node(path.nodes[i]).proof.store(proof, memory_order_relaxed);
+        if (i > 0)
+            this->arena.edge(path.edges[i - 1]).proof.store(proof, memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Works out the proof of a node from the proofs of its moves.
+ *
+ * The player to move picks the move but not the board after a redirect, so the player
+ * who moved into the node loses once there is a proven win on every board, and wins
+ * once every move on every board is proven lost.
+ *
+ * @param index The node.
+ * @param board The only board to look at, or POSITION_ANY_BOARD for all of the node's boards.
+ * @return The proof for the player who moved into the node.
+ */
+uint8_t MCTS::getProof(uint32_t index, int board)
+{
+    MCTSNode &node = this->arena.node(index);
+    if (node.state.load(memory_order_acquire) != MCTS_EXPANDED)
+        return MCTS_UNPROVEN;
+
+    uint16_t boards = 0;  // Boards with moves.
+    uint16_t winning = 0; // Boards with a proven win.
+    uint16_t open = 0;    // Boards with a move not proven lost.
+
+    for (uint32_t i = node.firstEdge; i < node.firstEdge + node.numEdges; i++)
+    {
+        MCTSEdge &edge = this->arena.edge(i);
+        if (board != POSITION_ANY_BOARD && edge.move / 9 != board)
+            continue;
+
+        uint16_t bit = (uint16_t)(1 << (edge.move / 9));
+        uint8_t proof = edge.proof.load(memory_order_relaxed);
+        boards |= bit;
+        if (proof == MCTS_PROVEN_WIN)
+            winning |= bit;
+        else if (proof != MCTS_PROVEN_LOSS)
+            open |= bit;
+    }
+
+    if (boards != 0 && winning == boards)
+        return MCTS_PROVEN_LOSS;
+    if (boards != 0 && winning == 0 && open == 0)
+        return MCTS_PROVEN_WIN;
+
+    return MCTS_UNPROVEN;
+}
+
+/**
+ * @brief Proves a new node from its position alone.
+ *
+ * The move into it won, or the player to move can complete a line on every board they
+ * can be on, which is one table lookup per board.
+ *
+ * @param position The position of the node.
+ * @return The proof for the player who moved into the node.
+ */
+uint8_t MCTS::getLeafProof(const Position &position)
+{
+    if (position.status == -position.toMove)
+        return MCTS_PROVEN_WIN;
+    if (!position.isRunning())
+        return MCTS_UNPROVEN;
+
+    int own = Position::side(position.toMove);
+    uint16_t boards = position.board == POSITION_ANY_BOARD ? position.openBoards() : (uint16_t)(1 << position.board);
+
+    for (; boards; boards &= boards - 1)
+    {
+        int b = BitBoard::lowestBit(boards);
+        if (!BitBoard::canWin(position.masks[own][b], position.masks[1 - own][b]))
+            return MCTS_UNPROVEN;
+    }
+
+    return MCTS_PROVEN_LOSS;
+}
+
+/**
+ * @brief Draws one of the boards that aren't full, like BoardManager::setRandomBoard().
+ */
+int MCTS::randomOpenBoard(const Position &position, Random &random)
+{
+    return random.pickBit(position.openBoards());
+}
+
+#endif
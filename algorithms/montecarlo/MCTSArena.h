@@ -0,0 +1,635 @@
+#ifndef MCTS_ARENA_H
+#define MCTS_ARENA_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+const uint32_t MCTS_NONE = 0xFFFFFFFF;
+const uint32_t MCTS_DEFAULT_MAX_NODES = 1 << 16;
+const uint32_t MCTS_EDGES_PER_NODE = 9;
+const uint32_t MCTS_MAX_EDGES = 81; // Most moves a node can have: a redirect with every cell empty.
+const int MCTS_MAX_PROBES = 32; // Slots the position table looks at before giving up.
+
+// Expansion states of a node.
+const uint8_t MCTS_UNEXPANDED = 0;
+const uint8_t MCTS_EXPANDING = 1; // A thread holds the node's lock and is adding its edges.
+const uint8_t MCTS_EXPANDED = 2;
+const uint8_t MCTS_LEAF = 3;      // The edge pool ran out, the node stays a leaf.
+
+// Game theoretic results found by the solver, for the player who made the move (edge)
+// or moved into the position (node).
+const uint8_t MCTS_UNPROVEN = 0;
+const uint8_t MCTS_PROVEN_WIN = 1;
+const uint8_t MCTS_PROVEN_LOSS = 2;
+
+/**
+ * @brief A move out of a node, together with the statistics of that move.
+ *
+ * Scores are counted in half points from the point of view of the player making the
+ * move: 2 for a win, 1 for a draw, 0 for a loss. The rave counter holds the same
+ * statistics for every playout where the move was played at any later point (AMAF),
+ * packed in one word so a playout updates both with a single atomic add. The counters
+ * are atomic so several threads can update the same tree; they only need relaxed ordering.
+ * The prior is written once when the node is expanded. The proof caches the proof of the
+ * child node, so selection can skip solved moves without reading their nodes.
+ */
+struct MCTSEdge
+{
+    atomic<uint32_t> child; // Node reached by the move, MCTS_NONE until it is visited.
+    atomic<uint32_t> visits;
+    atomic<uint32_t> score;
+    float prior;            // PolicyPrior probability of the move among those on its board.
+    atomic<uint64_t> rave;  // AMAF visits in the high half, AMAF score in the low half.
+    uint8_t move;           // board * 9 + cell
+    atomic<uint8_t> proof;  // MCTS_UNPROVEN, MCTS_PROVEN_WIN or MCTS_PROVEN_LOSS.
+};
+
+/**
+ * @brief A position in the search tree. Its edges sit next to each other in the edge pool.
+ *
+ * firstEdge and numEdges are written once by the thread that expands the node and
+ * published by storing MCTS_EXPANDED into state. The score counts the half points of
+ * every playout through the node for the player who moved into it; a graph search
+ * reads a move's value from there, so every move order reaching the position shares it.
+ * Once the position is solved its proof says who wins, and it never changes again.
+ */
+struct MCTSNode
+{
+    uint64_t key; // Zobrist hash of the position.
+    uint32_t firstEdge;
+    atomic<uint32_t> visits;
+    atomic<uint32_t> score;
+    uint8_t numEdges;
+    atomic<uint8_t> state;
+    atomic<uint8_t> proof; // MCTS_UNPROVEN, MCTS_PROVEN_WIN or MCTS_PROVEN_LOSS.
+};
+
+/**
+ * @brief A slot of the position table, mapping a position hash to its node.
+ */
+struct MCTSSlot
+{
+    atomic<uint64_t> key; // 0 while the slot is free.
+    atomic<uint32_t> node;
+};
+
+/**
+ * @brief Pool slots freed by a prune, handed out again by the allocators.
+ *
+ * Slots are only added while no thread is searching, so taking one is a single atomic
+ * increment of the read position.
+ */
+struct MCTSFreeList
+{
+    vector<uint32_t> items;
+    atomic<uint32_t> taken;
+
+    MCTSFreeList()
+        : taken(0)
+    {
+    }
+
+    /**
+     * @return A free slot, or MCTS_NONE if the list is used up.
+     */
+    uint32_t take()
+    {
+        // Checked first so a used up list isn't counted on by every failed allocation.
+        if (this->taken.load(memory_order_relaxed) >= this->items.size())
+            return MCTS_NONE;
+
+        uint32_t index = this->taken.fetch_add(1, memory_order_relaxed);
+        return index < this->items.size() ? this->items[index] : MCTS_NONE;
+    }
+
+    /**
+     * @return The number of slots left.
+     */
+    uint32_t remaining() const
+    {
+        uint32_t index = this->taken.load(memory_order_relaxed);
+        return index < this->items.size() ? (uint32_t)this->items.size() - index : 0;
+    }
+
+    /**
+     * @brief Drops the slots already taken. No thread may be allocating.
+     */
+    void compact()
+    {
+        this->items.erase(this->items.begin(), this->items.begin() + (this->items.size() - remaining()));
+        this->taken = 0;
+    }
+
+    void clear()
+    {
+        this->items.clear();
+        this->taken = 0;
+    }
+};
+
+/**
+ * @brief Preallocated pools for the nodes and edges of the search tree.
+ *
+ * Both pools are reserved once when the arena is built, then handed out by bumping an
+ * atomic index, so threads can allocate without a lock. Nothing is allocated or freed
+ * per node; reset() drops the whole tree at once, keepSubtree() all but one branch of it.
+ * When a pool runs out the allocators return MCTS_NONE and flag the arena as full.
+ *
+ * The pools are a hard cap on the memory of the tree. Once it is full, prune() cuts off
+ * the least visited subtrees and puts their nodes and edge blocks on free lists, which
+ * the allocators draw from after the pools. Edge blocks are rounded up to a multiple of
+ * MCTS_EDGES_PER_NODE so a freed block fits any node of the same class, which is every
+ * node bound to one board. Nothing is moved, so pruning costs one pass over the tree and
+ * never a compaction.
+ *
+ * With the position table on, the arena also maps position hashes to nodes so a graph
+ * search can give each position one node. The table is open addressed with twice as
+ * many slots as nodes and filled with compare and swap, so it needs no lock either.
+ */
+class MCTSArena
+{
+private:
+    vector<MCTSNode> nodes;
+    vector<MCTSEdge> edges;
+    vector<MCTSSlot> slots; // Empty while the position table is off.
+    atomic<uint32_t> nodeCount;
+    atomic<uint32_t> edgeCount;
+    MCTSFreeList freeNodes;
+    vector<MCTSFreeList> freeEdges; // Indexed by the size of the block over MCTS_EDGES_PER_NODE.
+    atomic<bool> full;              // An allocation failed since the last reset or prune.
+
+    void clearTable();
+    void clearFreeLists();
+    void findLive(uint32_t root, vector<uint8_t> &reached, vector<uint32_t> &live);
+    static uint32_t takeFromPool(atomic<uint32_t> &count, uint32_t size, size_t capacity);
+
+    /**
+     * @brief The number of nodes taken from the pool, including those freed since.
+     */
+    uint32_t getUsedNodes() const
+    {
+        uint32_t count = this->nodeCount.load(memory_order_relaxed);
+        return count < this->nodes.size() ? count : (uint32_t)this->nodes.size();
+    }
+
+public:
+    /**
+     * @brief The number of edges reserved for a node with count moves.
+     */
+    static uint32_t getBlockSize(uint32_t count)
+    {
+        return (count + MCTS_EDGES_PER_NODE - 1) / MCTS_EDGES_PER_NODE * MCTS_EDGES_PER_NODE;
+    }
+
+    MCTSArena(uint32_t maxNodes = MCTS_DEFAULT_MAX_NODES)
+        : nodes(maxNodes),
+          edges((size_t)maxNodes * MCTS_EDGES_PER_NODE),
+          nodeCount(0),
+          edgeCount(0),
+          freeEdges(MCTS_MAX_EDGES / MCTS_EDGES_PER_NODE + 1),
+          full(false)
+    {
+    }
+
+    /**
+     * @brief Drops the tree. No thread may be searching.
+     */
+    void reset()
+    {
+        this->nodeCount = 0;
+        this->edgeCount = 0;
+        this->full = false;
+        clearTable();
+        clearFreeLists();
+    }
+
+    /**
+     * @brief Checks if an allocation failed since the tree was last reset or pruned.
+     */
+    bool isFull() const
+    {
+        return this->full.load(memory_order_relaxed);
+    }
+
+    static uint32_t getCapacity(size_t bytes, bool table);
+    void resize(uint32_t maxNodes);
+    void setTable(bool enabled);
+    uint32_t allocateNode();
+    uint32_t allocateEdges(uint32_t count);
+    uint32_t keepSubtree(uint32_t root);
+    uint32_t prune(uint32_t root, uint32_t keep);
+    uint32_t findNode(uint64_t key) const;
+    uint32_t insertNode(uint64_t key, uint32_t index);
+
+    MCTSNode &node(uint32_t index)
+    {
+        return this->nodes[index];
+    }
+
+    MCTSEdge &edge(uint32_t index)
+    {
+        return this->edges[index];
+    }
+
+    /**
+     * @brief The number of nodes in use.
+     */
+    uint32_t getNodeCount() const
+    {
+        return getUsedNodes() - this->freeNodes.remaining();
+    }
+
+    uint32_t getEdgeCount() const
+    {
+        uint32_t count = this->edgeCount.load(memory_order_relaxed);
+        return count < this->edges.size() ? count : (uint32_t)this->edges.size();
+    }
+};
+
+/**
+ * @brief Finds how many nodes an arena can hold in a given amount of memory.
+ *
+ * @param bytes The memory for the pools, the free lists and the position table.
+ * @param table Whether the position table is on. It takes up to four slots per node.
+ */
+uint32_t MCTSArena::getCapacity(size_t bytes, bool table)
+{
+    size_t perNode = sizeof(MCTSNode) + MCTS_EDGES_PER_NODE * sizeof(MCTSEdge) + 2 * sizeof(uint32_t);
+    if (table)
+        perNode += 4 * sizeof(MCTSSlot);
+
+    size_t capacity = bytes / perNode;
+    return capacity < MCTS_NONE ? (uint32_t)capacity : MCTS_NONE - 1;
+}
+
+/**
+ * @brief Replaces the pools with pools for maxNodes nodes. Drops the tree.
+ */
+void MCTSArena::resize(uint32_t maxNodes)
+{
+    vector<MCTSNode>(maxNodes).swap(this->nodes);
+    vector<MCTSEdge>((size_t)maxNodes * MCTS_EDGES_PER_NODE).swap(this->edges);
+    if (!this->slots.empty())
+        setTable(true);
+    reset();
+}
+
+/**
+ * @brief Turns the position table on or off. Drops the tree.
+ */
+void MCTSArena::setTable(bool enabled)
+{
+    size_t size = 0;
+    while (enabled && size < 2 * this->nodes.size())
+        size = size ? size * 2 : 1;
+
+    vector<MCTSSlot>(size).swap(this->slots);
+    reset();
+}
+
+void MCTSArena::clearFreeLists()
+{
+    this->freeNodes.clear();
+    for (size_t i = 0; i < this->freeEdges.size(); i++)
+        this->freeEdges[i].clear();
+}
+
+void MCTSArena::clearTable()
+{
+    for (size_t i = 0; i < this->slots.size(); i++)
+    {
+        this->slots[i].key.store(0, memory_order_relaxed);
+        this->slots[i].node.store(MCTS_NONE, memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Looks a position up in the position table.
+ *
+ * @return The node of the position, or MCTS_NONE if it has none (or the table is off).
+ */
+uint32_t MCTSArena::findNode(uint64_t key) const
+{
+    size_t mask = this->slots.size() - 1;
+
+    for (int probe = 0; probe < MCTS_MAX_PROBES && !this->slots.empty(); probe++)
+    {
+        const MCTSSlot &slot = this->slots[(key + probe) & mask];
+        uint64_t stored = slot.key.load(memory_order_acquire);
+
+        if (stored == 0)
+            return MCTS_NONE;
+        if (stored != key)
+            continue;
+
+        // The key is claimed before the node is written, wait for the node.
+        uint32_t index;
+        while ((index = slot.node.load(memory_order_acquire)) == MCTS_NONE)
+            this_thread::yield();
+
+        return index;
+    }
+
+    return MCTS_NONE;
+}
+
+/**
+ * @brief Gives a position a node in the position table, unless it already has one.
+ *
+ * @param key The hash of the position. Never 0.
+ * @param index The node to store.
+ * @return The node the position has now: index, the node another thread stored first,
+ *         or MCTS_NONE if the table is off or too full around the key.
+ */
+uint32_t MCTSArena::insertNode(uint64_t key, uint32_t index)
+{
+    size_t mask = this->slots.size() - 1;
+
+    for (int probe = 0; probe < MCTS_MAX_PROBES && !this->slots.empty(); probe++)
+    {
+        MCTSSlot &slot = this->slots[(key + probe) & mask];
+        uint64_t stored = 0;
+
+        if (slot.key.compare_exchange_strong(stored, key, memory_order_acq_rel, memory_order_acquire))
+        {
+            slot.node.store(index, memory_order_release);
+            return index;
+        }
+
+        if (stored != key)
+            continue;
+
+        uint32_t owner;
+        while ((owner = slot.node.load(memory_order_acquire)) == MCTS_NONE)
+            this_thread::yield();
+
+        return owner;
+    }
+
+    return MCTS_NONE;
+}
+
+/**
+ * @brief Drops everything but the subtree under one node and packs it at the start of the pools.
+ *
+ * The live nodes and edge blocks are slid down in index order, so none is overwritten
+ * before it has moved. The freed space goes back to the allocators and the position
+ * table is rebuilt for the nodes that are left. No thread may be searching.
+ *
+ * @param root The node to keep, with everything below it.
+ * @return The new index of root. It is 0 unless a node below it sat at a lower index,
+ * through a transposition or a recycled slot.
+ */
+uint32_t MCTSArena::keepSubtree(uint32_t root)
+{
+    uint32_t count = getUsedNodes();
+    vector<uint32_t> remap(count, MCTS_NONE);
+    vector<uint8_t> reached;
+    vector<uint32_t> live;
+
+    findLive(root, reached, live);
+    sort(live.begin(), live.end());
+    for (size_t i = 0; i < live.size(); i++)
+        remap[live[i]] = (uint32_t)i;
+
+    // Slide the edge blocks down, in the order they were allocated.
+    vector<uint32_t> expanded;
+    for (size_t i = 0; i < live.size(); i++)
+        if (this->nodes[live[i]].state.load(memory_order_relaxed) == MCTS_EXPANDED)
+            expanded.push_back(live[i]);
+
+    sort(expanded.begin(), expanded.end(), [this](uint32_t a, uint32_t b)
+         { return this->nodes[a].firstEdge < this->nodes[b].firstEdge; });
+
+    uint32_t edgeCursor = 0;
+    for (size_t i = 0; i < expanded.size(); i++)
+    {
+        MCTSNode &node = this->nodes[expanded[i]];
+
+        for (uint32_t j = 0; j < node.numEdges; j++)
+        {
+            MCTSEdge &from = this->edges[node.firstEdge + j];
+            MCTSEdge &to = this->edges[edgeCursor + j];
+            uint32_t child = from.child.load(memory_order_relaxed);
+
+            to.child.store(child == MCTS_NONE ? MCTS_NONE : remap[child], memory_order_relaxed);
+            to.visits.store(from.visits.load(memory_order_relaxed), memory_order_relaxed);
+            to.score.store(from.score.load(memory_order_relaxed), memory_order_relaxed);
+            to.rave.store(from.rave.load(memory_order_relaxed), memory_order_relaxed);
+            to.prior = from.prior;
+            to.move = from.move;
+            to.proof.store(from.proof.load(memory_order_relaxed), memory_order_relaxed);
+        }
+
+        node.firstEdge = edgeCursor;
+        edgeCursor += getBlockSize(node.numEdges);
+    }
+
+    // Then the nodes.
+    for (size_t i = 0; i < live.size(); i++)
+    {
+        MCTSNode &from = this->nodes[live[i]];
+        MCTSNode &to = this->nodes[i];
+
+        to.key = from.key;
+        to.firstEdge = from.firstEdge;
+        to.visits.store(from.visits.load(memory_order_relaxed), memory_order_relaxed);
+        to.score.store(from.score.load(memory_order_relaxed), memory_order_relaxed);
+        to.numEdges = from.numEdges;
+        to.state.store(from.state.load(memory_order_relaxed), memory_order_relaxed);
+        to.proof.store(from.proof.load(memory_order_relaxed), memory_order_relaxed);
+    }
+
+    this->nodeCount = (uint32_t)live.size();
+    this->edgeCount = edgeCursor;
+    this->full = false;
+
+    clearFreeLists();
+    clearTable();
+    for (uint32_t i = 0; i < this->nodeCount && !this->slots.empty(); i++)
+        if (this->nodes[i].key != 0)
+            insertNode(this->nodes[i].key, i);
+
+    return remap[root];
+}
+
+/**
+ * @brief Frees the least visited nodes under root until at most keep are left.
+ *
+ * Every node visited no more often than the one that would be the keep-th most visited
+ * is cut off from the moves leading to it, which keep their own statistics, and every
+ * node no longer reachable from root goes on the free lists with its edges. Since a node
+ * is never visited more often than the moves into it, this drops whole subtrees from the
+ * bottom. No thread may be searching.
+ *
+ * @param root The root of the tree.
+ * @param keep The number of nodes to keep at most, root included.
+ * @return The number of nodes freed.
+ */
+uint32_t MCTSArena::prune(uint32_t root, uint32_t keep)
+{
+    vector<uint8_t> reached;
+    vector<uint32_t> live;
+
+    findLive(root, reached, live);
+    this->full = false;
+    if (keep < 1 || live.size() <= keep)
+        return 0;
+
+    // The visits of the most visited node that has to go.
+    vector<uint32_t> visits;
+    for (size_t i = 1; i < live.size(); i++)
+        visits.push_back(this->nodes[live[i]].visits.load(memory_order_relaxed));
+
+    size_t cut = live.size() - keep;
+    nth_element(visits.begin(), visits.begin() + (cut - 1), visits.end());
+    uint32_t threshold = visits[cut - 1];
+
+    for (size_t i = 0; i < live.size(); i++)
+    {
+        MCTSNode &node = this->nodes[live[i]];
+        if (node.state.load(memory_order_relaxed) != MCTS_EXPANDED)
+            continue;
+
+        for (uint32_t j = node.firstEdge; j < node.firstEdge + node.numEdges; j++)
+        {
+            uint32_t child = this->edges[j].child.load(memory_order_relaxed);
+            if (child != MCTS_NONE && this->nodes[child].visits.load(memory_order_relaxed) <= threshold)
+                this->edges[j].child.store(MCTS_NONE, memory_order_relaxed);
+        }
+    }
+
+    vector<uint8_t> kept;
+    vector<uint32_t> keptLive;
+    findLive(root, kept, keptLive);
+
+    // Every node out of the tree is free, also spares left over by a lost race. Only the
+    // nodes cut off now still own edges.
+    this->freeNodes.clear();
+    for (uint32_t i = 0; i < kept.size(); i++)
+        if (!kept[i])
+            this->freeNodes.items.push_back(i);
+
+    for (size_t i = 0; i < this->freeEdges.size(); i++)
+        this->freeEdges[i].compact();
+
+    for (size_t i = 0; i < live.size(); i++)
+    {
+        MCTSNode &node = this->nodes[live[i]];
+        if (!kept[live[i]] && node.state.load(memory_order_relaxed) == MCTS_EXPANDED)
+            this->freeEdges[getBlockSize(node.numEdges) / MCTS_EDGES_PER_NODE].items.push_back(node.firstEdge);
+    }
+
+    clearTable();
+    for (size_t i = 0; i < keptLive.size() && !this->slots.empty(); i++)
+        if (this->nodes[keptLive[i]].key != 0)
+            insertNode(this->nodes[keptLive[i]].key, keptLive[i]);
+
+    return (uint32_t)(live.size() - keptLive.size());
+}
+
+/**
+ * @brief Lists the nodes reachable from root, root first.
+ *
+ * @param root The root of the tree.
+ * @param reached Set to one flag per used node, 1 for the reachable ones.
+ * @param live Set to the reachable nodes.
+ */
+void MCTSArena::findLive(uint32_t root, vector<uint8_t> &reached, vector<uint32_t> &live)
+{
+    reached.assign(getUsedNodes(), 0);
+    live.assign(1, root);
+    reached[root] = 1;
+
+    for (size_t i = 0; i < live.size(); i++)
+    {
+        MCTSNode &node = this->nodes[live[i]];
+        if (node.state.load(memory_order_relaxed) != MCTS_EXPANDED)
+            continue;
+
+        for (uint32_t j = node.firstEdge; j < node.firstEdge + node.numEdges; j++)
+        {
+            uint32_t child = this->edges[j].child.load(memory_order_relaxed);
+            if (child != MCTS_NONE && !reached[child])
+            {
+                reached[child] = 1;
+                live.push_back(child);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Moves a pool counter on by size, unless that would pass the capacity.
+ *
+ * Once the pool is used up the counter stays where it is, however many allocations the
+ * free lists serve after that, so it can't wrap around on a long run.
+ *
+ * @return The first index taken, or MCTS_NONE if the pool has no room left.
+ */
+uint32_t MCTSArena::takeFromPool(atomic<uint32_t> &count, uint32_t size, size_t capacity)
+{
+    uint32_t first = count.load(memory_order_relaxed);
+    do
+    {
+        if ((size_t)first + size > capacity)
+            return MCTS_NONE;
+    } while (!count.compare_exchange_weak(first, first + size, memory_order_relaxed));
+
+    return first;
+}
+
+/**
+ * @brief Takes a fresh, unexpanded node from the pool, or else from the free list.
+ *
+ * @return The index of the node, or MCTS_NONE if there is none left.
+ */
+uint32_t MCTSArena::allocateNode()
+{
+    uint32_t index = takeFromPool(this->nodeCount, 1, this->nodes.size());
+    if (index == MCTS_NONE)
+        index = this->freeNodes.take();
+
+    if (index == MCTS_NONE)
+    {
+        this->full.store(true, memory_order_relaxed);
+        return MCTS_NONE;
+    }
+
+    MCTSNode &node = this->nodes[index];
+    node.key = 0;
+    node.firstEdge = MCTS_NONE;
+    node.visits.store(0, memory_order_relaxed);
+    node.score.store(0, memory_order_relaxed);
+    node.numEdges = 0;
+    node.state.store(MCTS_UNEXPANDED, memory_order_relaxed);
+    node.proof.store(MCTS_UNPROVEN, memory_order_relaxed);
+
+    return index;
+}
+
+/**
+ * @brief Takes a block of consecutive edges from the pool, or else a freed block of the same size.
+ *
+ * @param count The number of edges needed. The block is rounded up with getBlockSize().
+ * @return The index of the first edge, or MCTS_NONE if there is no room for the block.
+ */
+uint32_t MCTSArena::allocateEdges(uint32_t count)
+{
+    uint32_t size = getBlockSize(count);
+    uint32_t first = takeFromPool(this->edgeCount, size, this->edges.size());
+    if (first == MCTS_NONE)
+        first = this->freeEdges[size / MCTS_EDGES_PER_NODE].take();
+
+    if (first == MCTS_NONE)
+        this->full.store(true, memory_order_relaxed);
+
+    return first;
+}
+
+#endif
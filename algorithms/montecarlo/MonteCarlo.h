@@ -4,22 +4,64 @@
 #include "../../TicTacToe.h"
 #include "../../struct/Coordinate.h"
 #include "../base/Algorithm.h"
+#include "../../helpers/ThreadPool.h"
+#include "../base/Position.h"
+#include "./BatchPlayout.h"
 
+#include <algorithm>
+#include <cmath>
+#include <functional>
 #include <limits>
+#include <memory>
+#include <vector>
 
 using namespace std;
 
+const int MONTE_CARLO_ROUND_PLAYOUTS = 64; // Playouts per move between budget checks.
+
+// How the playouts are shared out between the moves at the root.
+const int MONTE_CARLO_UNIFORM = 0; // Every move gets the same number of playouts.
+const int MONTE_CARLO_HALVING = 1; // Sequential halving: the worse half of the moves is dropped after each phase.
+
+const double MONTE_CARLO_CONFIDENCE = 0.05; // Chance of stopping early on the wrong move.
+
+/**
+ * @brief Everything one thread of the search writes to.
+ *
+ * Each worker has its own random stream and counters, aligned to a cache line, so the
+ * threads never share a cache line or a lock while they play. The results are added up after the threads finish.
+ */
+struct alignas(64) MonteCarloWorker
+{
+    Random random;
+    long long wins[BOARD_SIZE * BOARD_SIZE];
+    long long counts[BOARD_SIZE * BOARD_SIZE]; // Playouts of each move.
+    long long playouts;
+    long long nodes;
+    int maxDepth;
+};
+
 class MonteCarlo : public Algorithm
 {
 private:
     int numSimulations;
+    int allocation;
+    uint16_t candidates; // Moves still in the race; the best of them is played.
+    SearchBudget budget;
+    PlayoutPolicy policy;
+    unique_ptr<ThreadPool> pool;
+    vector<MonteCarloWorker> workers;
 
     // PRIVATE METHODS
-    int simulateMoveForPosition(int moveX, int moveY, const Coordinate *currentBoard);
-    int playOutGame(TicTacToe (*tempGrid)[3][3], TicTacToe *tempBoard);
-    void simulateMove(TicTacToe *tempBoard, int &tempPlayer, int &status, int &moveX, int &moveY);
-    void switchBoard(TicTacToe (*tempGrid)[3][3], TicTacToe **tempBoard, int x, int y);
-    void copyBoard(TicTacToe (*tempGrid)[3][3]);
+    void runOnWorkers(const function<void(int)> &job);
+    void resetWorker(int worker, uint64_t seed);
+    void runWorker(int worker, const Position &position);
+    void runRounds(int worker, const Position &position, uint16_t moves, const SearchBudget &budget);
+    void runHalving(const Position &position);
+    bool isSeparated(int numArms) const;
+    void getTotals(int cell, long long *wins, long long *count) const;
+    double getWinRate(int cell) const;
+    int simulateMoveForPosition(int moveX, int moveY, const Position &position, int numPlayouts, MonteCarloWorker &worker);
 
 public:
     /**
@@ -28,45 +70,98 @@ public:
      * @param grid The initial grid of the Tic-Tac-Toe game.
      * @param player The player making the moves (0 or 1).
      * @param numSimulations The number of simulations to perform.
+     * @param numThreads The number of threads sharing the simulations.
      */
-    MonteCarlo(TicTacToe (*grid)[3][3], int player, int numSimulations = 1000)
+    MonteCarlo(TicTacToe (*grid)[3][3], int player, int numSimulations = 1000, int numThreads = 1)
         : Algorithm(grid, player),
-          numSimulations(numSimulations)
+          numSimulations(numSimulations),
+          allocation(MONTE_CARLO_HALVING),
+          candidates(0)
     {
+        setNumThreads(numThreads);
     }
 
     void useAlgorithm(int *x, int *y, const Coordinate *currentBoard);
+    string getName() const override;
+    void setNumThreads(int numThreads) override;
+    void setBudget(const SearchBudget &budget) override;
+
+    /**
+     * @brief Switches the playouts between random and heavy moves.
+     */
+    void setPlayoutPolicy(const PlayoutPolicy &policy) override
+    {
+        this->policy = policy;
+    }
+
+    /**
+     * @brief Chooses how the playouts are shared out between the moves.
+     *
+     * @param allocation MONTE_CARLO_UNIFORM or MONTE_CARLO_HALVING.
+     */
+    void setAllocation(int allocation)
+    {
+        this->allocation = allocation;
+    }
 };
 
 /**
  * @brief Determines the best move for the current board state using Monte Carlo simulations.
  *
+ * The simulations are split evenly over the threads. Each thread draws from its own
+ * stream, seeded from the engine's, so with the same seed and thread count the search
+ * picks the same move. With a budget set the search is anytime: the moves are sampled
+ * in rounds until the budget is used up, and the best win rate is played.
+ *
+ * By default the playouts are shared out by sequential halving (see runHalving), which
+ * stops spending on moves that are clearly losing. setAllocation(MONTE_CARLO_UNIFORM)
+ * gives every move the same number of playouts instead.
+ *
  * @param x Pointer to store the x-coordinate of the best move.
  * @param y Pointer to store the y-coordinate of the best move.
  * @param currentBoard The current state of the board.
  */
 void MonteCarlo::useAlgorithm(int *x, int *y, const Coordinate *currentBoard)
 {
-    int bestScore = NEGATIVE_INFINITY;
+    beginSearch();
+
+    // Opening moves come from the book when one is open.
+    if (playBookMove(x, y, currentBoard))
+    {
+        endSearch(*x, *y);
+        return;
+    }
+
+    double bestScore = -1.0;
     int bestMoveX = -1, bestMoveY = -1;
 
-    // Get the current board
-    TicTacToe *board = &(*this->grid)[currentBoard->x][currentBoard->y];
+    Position position = Position::fromGrid(this->grid, currentBoard, this->player);
+    uint64_t seed = this->random.next();
+
+    for (size_t i = 0; i < this->workers.size(); i++)
+        resetWorker((int)i, seed);
+
+    // Run the simulations, on the calling thread alone or on every thread of the pool
+    this->candidates = position.emptyCells(position.board);
 
-    // Simulate all possible moves in the current state
+    if (this->allocation == MONTE_CARLO_HALVING && BitBoard::popCount(this->candidates) > 2)
+        runHalving(position);
+    else
+        runOnWorkers([this, &position](int worker)
+                     { runWorker(worker, position); });
+
+    // Compare the moves still in the race
     for (int moveX = 0; moveX < BOARD_SIZE; moveX++)
     {
         for (int moveY = 0; moveY < BOARD_SIZE; moveY++)
         {
-            // If the cell is empty, simulate the move
-            if (board->getCell(moveX, moveY) == 0)
+            if (this->candidates & (1 << (moveX * BOARD_SIZE + moveY)))
             {
-                int totalWins = simulateMoveForPosition(moveX, moveY, currentBoard);
-
-                // Evaluate the move based on the number of wins
-                if (totalWins > bestScore)
+                // Evaluate the move based on its win rate
+                double winRate = getWinRate(moveX * BOARD_SIZE + moveY);
+                if (winRate > bestScore)
                 {
-                    bestScore = totalWins;
+                    bestScore = winRate;
                     bestMoveX = moveX;
                     bestMoveY = moveY;
                 }
@@ -74,149 +169,323 @@ void MonteCarlo::useAlgorithm(int *x, int *y, const Coordinate *currentBoard)
         }
     }
 
+    // Merge the counters of the workers
+    for (size_t i = 0; i < this->workers.size(); i++)
+    {
+        this->stats.playouts += this->workers[i].playouts;
+        this->stats.nodes += this->workers[i].nodes;
+        this->stats.maxDepth = std::max(this->stats.maxDepth, this->workers[i].maxDepth);
+    }
+
     // Return the best move found
     *x = bestMoveX;
     *y = bestMoveY;
+
+    endSearch(bestMoveX, bestMoveY);
+}
+
+string MonteCarlo::getName() const
+{
+    return "Monte Carlo";
 }
 
 /**
- * @brief Simulates a move for a given position and returns the total number of wins.
+ * @brief Sets the number of threads. The threads are started here, not on every move.
  *
- * @param moveX The x-coordinate of the move to simulate.
- * @param moveY The y-coordinate of the move to simulate.
- * @param currentBoard The current state of the board to be used for simulation.
- * @return The total number of wins for the simulated move.
+ * @param numThreads The number of threads, 0 for one per hardware thread.
  */
-int MonteCarlo::simulateMoveForPosition(int moveX, int moveY, const Coordinate *currentBoard)
+void MonteCarlo::setNumThreads(int numThreads)
 {
-    int totalWins = 0;
+    if (numThreads < 1)
+        numThreads = ThreadPool::defaultNumThreads();
 
-    for (int i = 0; i < this->numSimulations; i++)
-    {
-        // Create a temporary copy of the grid
-        TicTacToe tempGrid[3][3];
-
-        // Copy the current board
-        copyBoard(&tempGrid);
+    this->pool.reset(numThreads > 1 ? new ThreadPool(numThreads) : nullptr);
+    this->workers.assign(numThreads, MonteCarloWorker());
+}
 
-        // Get the first board
-        TicTacToe *tempBoard = &tempGrid[currentBoard->x][currentBoard->y];
+/**
+ * @brief Switches to anytime mode: every move samples until the budget is used up.
+ *
+ * The playout budget counts the playouts of all candidate moves together.
+ *
+ * @param budget The budget per move.
+ */
+void MonteCarlo::setBudget(const SearchBudget &budget)
+{
+    this->budget = budget;
+}
 
-        // Make the move
-        tempBoard->addMove(moveX, moveY, this->player);
+/**
+ * @brief Runs job(worker) on the calling thread alone or on every thread of the pool.
+ */
+void MonteCarlo::runOnWorkers(const function<void(int)> &job)
+{
+    if (this->pool)
+        this->pool->run(job);
+    else
+        job(0);
+}
 
-        // Initial board switch
-        switchBoard(&tempGrid, &tempBoard, moveX, moveY);
+/**
+ * @brief Clears a worker's counters and seeds its stream for a new search.
+ *
+ * @param worker The index of the worker.
+ * @param seed The seed of this search. Worker w draws from seed + w.
+ */
+void MonteCarlo::resetWorker(int worker, uint64_t seed)
+{
+    MonteCarloWorker &slot = this->workers[worker];
 
-        // Simulate the game outcome
-        int status = playOutGame(&tempGrid, tempBoard);
+    slot.random.seed(seed + worker);
+    slot.playouts = 0;
+    slot.nodes = 0;
+    slot.maxDepth = 0;
 
-        // If the player wins, increment the win count
-        if (status == player)
-        {
-            totalWins++;
-        }
+    for (int cell = 0; cell < BOARD_SIZE * BOARD_SIZE; cell++)
+    {
+        slot.wins[cell] = 0;
+        slot.counts[cell] = 0;
     }
-
-    return totalWins;
 }
 
 /**
- * @brief Plays out the game from a given board state until completion.
+ * @brief Runs one thread's share of the simulations of every move.
  *
- * @param tempGrid A temporary copy of the grid used for simulation.
- * @param tempBoard The board from which to start the game simulation.
- * @return The final status of the game (win/loss/draw).
+ * @param worker The index of the worker.
+ * @param position The current position.
  */
-int MonteCarlo::playOutGame(TicTacToe (*tempGrid)[3][3], TicTacToe *tempBoard)
+void MonteCarlo::runWorker(int worker, const Position &position)
 {
-    // Initial status and the current player
-    int status = tempBoard->gameStatus();
-    int tempPlayer = player;
+    MonteCarloWorker &slot = this->workers[worker];
+    int numWorkers = (int)this->workers.size();
 
-    // Start simulation
-    while (status == GAME_RUNNING)
+    if (this->budget.isSet())
     {
-        int x, y;
+        runRounds(worker, position, this->candidates, this->budget);
+        return;
+    }
 
-        // Simulate a random move
-        simulateMove(tempBoard, tempPlayer, status, x, y);
+    // Worker w takes simulations [N * w / T, N * (w + 1) / T) of each move
+    int numPlayouts = this->numSimulations * (worker + 1) / numWorkers - this->numSimulations * worker / numWorkers;
 
-        // Switch a board if the game is not over.
-        if (status == GAME_RUNNING)
+    for (int cell = 0; cell < BOARD_SIZE * BOARD_SIZE; cell++)
+    {
+        if (this->candidates & (1 << cell))
         {
-            switchBoard(tempGrid, &tempBoard, x, y);
+            slot.wins[cell] = simulateMoveForPosition(cell / BOARD_SIZE, cell % BOARD_SIZE, position, numPlayouts, slot);
+            slot.counts[cell] = numPlayouts;
         }
     }
-
-    // Return the game status after simulation
-    return status;
 }
 
 /**
- * @brief Simulates a random move on the given board and updates the status.
+ * @brief Samples the given moves in rounds until this worker's part of the budget is used up.
+ *
+ * Each round gives every move the same number of playouts, so the moves end up with
+ * equal counts. At least one round is played, however small the budget.
  *
- * @param tempBoard The board to simulate the move on.
- * @param tempPlayer The current player performing the move.
- * @param status The status of the game after the move.
- * @param x The x-coordinate of the move performed.
- * @param y The y-coordinate of the move performed.
+ * @param worker The index of the worker.
+ * @param position The current position.
+ * @param moves The cells to sample.
+ * @param budget The playouts of all workers for this call, and the time since the start
+ *               of the search at which to stop.
  */
-void MonteCarlo::simulateMove(TicTacToe *tempBoard, int &tempPlayer, int &status, int &x, int &y)
+void MonteCarlo::runRounds(int worker, const Position &position, uint16_t moves, const SearchBudget &budget)
 {
-    // Switch the player
-    bool isValid = false;
-    tempPlayer = (tempPlayer == player) ? enemyPlayer : player;
+    MonteCarloWorker &slot = this->workers[worker];
+    long long numWorkers = (long long)this->workers.size();
+    int numMoves = BitBoard::popCount(moves);
+    long long start = slot.playouts;
+
+    // Worker w takes playouts [N * w / T, N * (w + 1) / T) of the budget
+    SearchBudget share = budget;
+    if (share.playouts > 0)
+    {
+        share.playouts = budget.playouts * (worker + 1) / numWorkers - budget.playouts * worker / numWorkers;
+        if (share.playouts == 0)
+            return;
+    }
 
-    // Generate a random move while board is not empty.
-    int randX, randY;
     do
     {
-        Tools::generateRandomMove(&randX, &randY);
-        isValid = tempBoard->isValidMove(randX, randY);
-    } while (!isValid);
-
-    // Add the random move
-    tempBoard->addMove(randX, randY, tempPlayer);
+        // The last round shrinks to what is left of the playout budget
+        int numPlayouts = MONTE_CARLO_ROUND_PLAYOUTS;
+        if (share.playouts > 0)
+            numPlayouts = (int)std::min<long long>(numPlayouts, (share.playouts - (slot.playouts - start)) / numMoves);
 
-    // Update status
-    status = tempBoard->gameStatus();
+        if (numPlayouts == 0 && slot.playouts > start)
+            break;
 
-    // Assign move
-    x = randX;
-    y = randY;
+        for (uint16_t rest = moves; rest; rest &= rest - 1)
+        {
+            int cell = BitBoard::lowestBit(rest);
+            slot.wins[cell] += simulateMoveForPosition(cell / BOARD_SIZE, cell % BOARD_SIZE, position, std::max(numPlayouts, 1), slot);
+            slot.counts[cell] += std::max(numPlayouts, 1);
+        }
+    } while (!share.isExhausted(slot.playouts - start, getElapsedMs()));
 }
 
 /**
- * @brief Switches the board being played.
+ * @brief Shares the budget out by sequential halving.
+ *
+ * The search runs in ceil(log2 K) phases for K moves. Each phase splits an equal part of
+ * the budget evenly over the moves still in the race, then drops the worse half of them
+ * by win rate, so most playouts go to the moves that might be best. Without a budget the
+ * total is numSimulations for every move, as in the uniform search. A time budget is
+ * cut into equal slices, one per phase.
+ *
+ * The search stops early once a Hoeffding bound separates the best move from the rest.
+ * Afterwards this->candidates holds the moves that survived.
  *
- * @param tempGrid The grid containing the updated board states.
- * @param tempBoard A pointer to the board to update.
- * @param x The x-coordinate of the move.
- * @param y The y-coordinate of the move.
+ * @param position The current position.
  */
-void MonteCarlo::switchBoard(TicTacToe (*tempGrid)[3][3], TicTacToe **tempBoard, int x, int y)
+void MonteCarlo::runHalving(const Position &position)
 {
-    // Update the address of tempBoard to point to the new board.
-    *tempBoard = &(*tempGrid)[x][y];
+    int numMoves = BitBoard::popCount(this->candidates);
+    int numPhases = 0;
+    while ((1 << numPhases) < numMoves)
+        numPhases++;
+
+    SearchBudget total = this->budget;
+    if (!total.isSet())
+        total.playouts = (long long)this->numSimulations * numMoves;
+
+    long long spent = 0;
+    for (int phase = 0; phase < numPhases; phase++)
+    {
+        // This phase gets an equal part of what is left
+        SearchBudget slice;
+        if (total.playouts > 0)
+            slice.playouts = (total.playouts - spent) / (numPhases - phase);
+        if (total.milliseconds > 0)
+            slice.milliseconds = total.milliseconds * (phase + 1) / numPhases;
+
+        uint16_t moves = this->candidates;
+        runOnWorkers([this, &position, moves, &slice](int worker)
+                     { runRounds(worker, position, moves, slice); });
+
+        spent = 0;
+        for (size_t i = 0; i < this->workers.size(); i++)
+            spent += this->workers[i].playouts;
+
+        if (isSeparated(numMoves * numPhases) || (total.milliseconds > 0 && getElapsedMs() >= total.milliseconds))
+            break;
+
+        // Keep the better half, ties going to the lower cell
+        int ranked[BOARD_SIZE * BOARD_SIZE];
+        int numRanked = 0;
+        for (uint16_t rest = moves; rest; rest &= rest - 1)
+            ranked[numRanked++] = BitBoard::lowestBit(rest);
+
+        stable_sort(ranked, ranked + numRanked, [this](int a, int b)
+                    { return getWinRate(a) > getWinRate(b); });
+
+        this->candidates = 0;
+        for (int i = 0; i < (numRanked + 1) / 2; i++)
+            this->candidates |= 1 << ranked[i];
+    }
 }
 
 /**
- * @brief Copies the board passed to the passed temporary grid.
+ * @brief Checks if the best candidate is better than every other one with high confidence.
+ *
+ * Each win rate gets a Hoeffding interval of half-width sqrt(ln(2 * numArms / delta) / 2n),
+ * where numArms counts every interval the search may test. The best move is separated
+ * when its lower bound is above the upper bound of every other candidate.
  *
- * @param tempGrid The grid to copy the current board state into.
+ * @param numArms The number of tests the confidence is shared between.
  */
-void MonteCarlo::copyBoard(TicTacToe (*tempGrid)[3][3])
+bool MonteCarlo::isSeparated(int numArms) const
 {
-    // Check rows and cols
-    for (int row = 0; row < BOARD_SIZE; row++)
+    double logTerm = log(2.0 * numArms / MONTE_CARLO_CONFIDENCE);
+    int best = -1;
+    double bestLower = 0.0;
+
+    for (uint16_t rest = this->candidates; rest; rest &= rest - 1)
     {
-        for (int col = 0; col < BOARD_SIZE; col++)
+        int cell = BitBoard::lowestBit(rest);
+        long long wins, count;
+        getTotals(cell, &wins, &count);
+        if (count == 0)
+            return false;
+
+        double lower = (double)wins / count - sqrt(logTerm / (2.0 * count));
+        if (best < 0 || getWinRate(cell) > getWinRate(best))
         {
-            // Assign each to the temporary grid
-            (*tempGrid)[row][col] = (*this->grid)[row][col];
+            best = cell;
+            bestLower = lower;
         }
     }
+
+    for (uint16_t rest = this->candidates; rest; rest &= rest - 1)
+    {
+        int cell = BitBoard::lowestBit(rest);
+        if (cell == best)
+            continue;
+
+        long long wins, count;
+        getTotals(cell, &wins, &count);
+        if ((double)wins / count + sqrt(logTerm / (2.0 * count)) >= bestLower)
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Adds up the wins and playouts of a move over every worker.
+ */
+void MonteCarlo::getTotals(int cell, long long *wins, long long *count) const
+{
+    *wins = 0;
+    *count = 0;
+    for (size_t i = 0; i < this->workers.size(); i++)
+    {
+        *wins += this->workers[i].wins[cell];
+        *count += this->workers[i].counts[cell];
+    }
+}
+
+/**
+ * @brief The win rate of a move over every worker, 0 if it wasn't played.
+ */
+double MonteCarlo::getWinRate(int cell) const
+{
+    long long wins, count;
+    getTotals(cell, &wins, &count);
+    return count > 0 ? (double)wins / count : 0.0;
+}
+
+/**
+ * @brief Simulates a move for a given position and returns the total number of wins.
+ *
+ * The playouts go through BatchPlayout, which plays eight games at a time with AVX2.
+ *
+ * @param moveX The x-coordinate of the move to simulate.
+ * @param moveY The y-coordinate of the move to simulate.
+ * @param position The current position.
+ * @param numPlayouts The number of simulations to run.
+ * @param worker The worker running them.
+ * @return The total number of wins for the simulated move.
+ */
+int MonteCarlo::simulateMoveForPosition(int moveX, int moveY, const Position &position, int numPlayouts, MonteCarloWorker &worker)
+{
+    // Make the move
+    Position tempPosition = position;
+    tempPosition.play(tempPosition.board, moveX * BOARD_SIZE + moveY);
+
+    // Simulate the game outcomes
+    BatchPlayoutResult result;
+    BatchPlayout::run(tempPosition, numPlayouts, this->policy, worker.random, result);
+
+    worker.playouts += numPlayouts;
+    worker.nodes += result.steps;
+
+    // Track the longest playout, counting the root move.
+    worker.maxDepth = std::max(worker.maxDepth, result.maxPlies + 1);
+
+    // Return the number of wins for the player
+    return (int)result.wins[Position::side(this->player)];
 }
 
 #endif
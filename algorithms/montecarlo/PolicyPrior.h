@@ -0,0 +1,80 @@
+#ifndef POLICY_PRIOR_H
+#define POLICY_PRIOR_H
+
+#include "../../helpers/BitBoard.h"
+#include "../base/Position.h"
+#include "../heuristic/base/HeuristicTable.h"
+#include "./HeavyPlayout.h"
+
+#include <cstdint>
+
+// Weights of the static policy. A move's prior is its weight over the weights of every
+// move on the same board.
+const float POLICY_PRIOR_CENTRE = 3.0f;
+const float POLICY_PRIOR_CORNER = 2.0f;
+const float POLICY_PRIOR_CROSS = 1.0f;
+const float POLICY_PRIOR_WINS = 16.0f;      // Factor for a move that wins the board.
+const float POLICY_PRIOR_BLOCKS = 4.0f;     // Factor for a move that takes the enemy's winning cell.
+const float POLICY_PRIOR_SENDS_LOSS = 0.25f; // Factor for a move that sends the enemy to a board it can win.
+
+/**
+ * @brief A fast static policy over the moves of a position, used as the priors of PUCT.
+ *
+ * Each move starts from the centre > corners > cross ranking of HeuristicSearch and is
+ * then scaled by its threats, found with the same table lookups as the heavy playouts.
+ */
+class PolicyPrior
+{
+public:
+    static void getPriors(const Position &position, const uint8_t *moves, int count, float *priors);
+};
+
+/**
+ * @brief Gives every move its prior.
+ *
+ * @param position The position the moves are played from.
+ * @param moves The moves (board * 9 + cell), as Position::legalMoves() lists them.
+ * @param count The number of moves.
+ * @param priors Receives one prior per move. Those of a board add up to 1.
+ */
+void PolicyPrior::getPriors(const Position &position, const uint8_t *moves, int count, float *priors)
+{
+    const uint32_t *threats = HEAVY_PLAYOUT_TABLES.threats;
+    int own = Position::side(position.toMove);
+    float totals[POSITION_NUM_BOARDS] = {0};
+
+    for (int i = 0; i < count; i++)
+    {
+        int board = moves[i] / 9;
+        int cell = moves[i] % 9;
+        uint16_t bit = (uint16_t)(1 << cell);
+        uint16_t ownCells = position.masks[own][board];
+        uint16_t enemyCells = position.masks[1 - own][board];
+
+        float weight = POLICY_PRIOR_CROSS;
+        if (cell == HEURISTIC_CENTRE)
+            weight = POLICY_PRIOR_CENTRE;
+        else if (HEAVY_PLAYOUT_TABLES.corners & bit)
+            weight = POLICY_PRIOR_CORNER;
+
+        uint32_t current = threats[BitBoard::ternaryIndex(ownCells, enemyCells)];
+        if (current & bit)
+            weight *= POLICY_PRIOR_WINS;
+        if ((current >> HEAVY_PLAYOUT_BLOCK_SHIFT) & bit)
+            weight *= POLICY_PRIOR_BLOCKS;
+
+        // The board the enemy is sent to. It gets the move too when it is this board.
+        uint16_t targetOwn = position.masks[own][cell] | (cell == board ? bit : 0);
+        uint16_t targetEnemy = position.masks[1 - own][cell];
+        if ((targetOwn | targetEnemy) != BITBOARD_FULL && threats[BitBoard::ternaryIndex(targetOwn, targetEnemy)] >> HEAVY_PLAYOUT_BLOCK_SHIFT)
+            weight *= POLICY_PRIOR_SENDS_LOSS;
+
+        priors[i] = weight;
+        totals[board] += weight;
+    }
+
+    for (int i = 0; i < count; i++)
+        priors[i] /= totals[moves[i] / 9];
+}
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <cstdint>
+
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+// A single 3 x 3 board is stored as one 9 bit mask per player.
+// Bit (row * 3 + col) is set when the player holds that cell.
+const uint16_t BITBOARD_FULL = 0x1FF;
+const int BITBOARD_NUM_CELLS = 9;
+const int BITBOARD_NUM_LINES = 8;
+const int BITBOARD_NUM_MASKS = 512;
+const int BITBOARD_NUM_STATES = 19683; // 3^9
+const uint8_t BITBOARD_ALL_LINES = 0xFF;   // One bit per line.
+
+// Rows, columns and diagonals.
+const uint16_t BITBOARD_LINES[BITBOARD_NUM_LINES] = {
+    0x007, 0x038, 0x1C0, // Rows
+    0x049, 0x092, 0x124, // Columns
+    0x111, 0x054         // Diagonals
+};
+
+/**
+ * @brief Lookup tables behind the BitBoard helpers, built once at startup.
+ */
+struct BitBoardTables
+{
+    bool isWin[BITBOARD_NUM_MASKS];
+    uint16_t ternary[BITBOARD_NUM_MASKS]; // Sum of 3^i over the set bits.
+    uint8_t nthBit[BITBOARD_NUM_MASKS][BITBOARD_NUM_CELLS]; // Index of the n-th set bit.
+    uint8_t lines[BITBOARD_NUM_MASKS];    // Bit l is set when the mask holds a cell of line l.
+    uint8_t pairs[BITBOARD_NUM_MASKS];    // Bit l is set when the mask holds exactly two cells of line l.
+
+    BitBoardTables()
+    {
+        for (int mask = 0; mask < BITBOARD_NUM_MASKS; mask++)
+        {
+            this->isWin[mask] = false;
+            this->lines[mask] = 0;
+            this->pairs[mask] = 0;
+            for (int line = 0; line < BITBOARD_NUM_LINES; line++)
+            {
+                if ((mask & BITBOARD_LINES[line]) == BITBOARD_LINES[line])
+                    this->isWin[mask] = true;
+                if (mask & BITBOARD_LINES[line])
+                    this->lines[mask] |= (uint8_t)(1 << line);
+                if (__builtin_popcount(mask & BITBOARD_LINES[line]) == 2)
+                    this->pairs[mask] |= (uint8_t)(1 << line);
+            }
+
+            this->ternary[mask] = 0;
+            for (int cell = 0, power = 1; cell < BITBOARD_NUM_CELLS; cell++, power *= 3)
+            {
+                if (mask & (1 << cell))
+                    this->ternary[mask] += power;
+            }
+
+            for (int n = 0; n < BITBOARD_NUM_CELLS; n++)
+                this->nthBit[mask][n] = 0;
+
+            for (int cell = 0, n = 0; cell < BITBOARD_NUM_CELLS; cell++)
+            {
+                if (mask & (1 << cell))
+                    this->nthBit[mask][n++] = (uint8_t)cell;
+            }
+        }
+    }
+};
+
+const BitBoardTables BITBOARD_TABLES;
+
+class BitBoard
+{
+public:
+    /**
+     * @brief Gets the bit of a cell.
+     */
+    static uint16_t cellBit(int x, int y)
+    {
+        return (uint16_t)(1 << (x * 3 + y));
+    }
+
+    /**
+     * @brief Checks if the mask holds a complete row, column or diagonal.
+     */
+    static bool isWin(uint16_t mask)
+    {
+        return BITBOARD_TABLES.isWin[mask];
+    }
+
+    /**
+     * @brief Checks if neither player can still complete a line, every line holding a cell of each.
+     *
+     * @param playerOne The mask of player 1.
+     * @param playerTwo The mask of player -1.
+     */
+    static bool isDead(uint16_t playerOne, uint16_t playerTwo)
+    {
+        return (BITBOARD_TABLES.lines[playerOne] & BITBOARD_TABLES.lines[playerTwo]) == BITBOARD_ALL_LINES;
+    }
+
+    /**
+     * @brief Checks if a player can still complete a line, some line holding no cell of the enemy.
+     */
+    static bool hasOpenLine(uint16_t enemy)
+    {
+        return BITBOARD_TABLES.lines[enemy] != BITBOARD_ALL_LINES;
+    }
+
+    /**
+     * @brief Checks if "own" has a cell that wins the board straight away.
+     *
+     * Same as Threats::winningCells(own, enemy) != 0, with two 512 entry lookups.
+     */
+    static bool canWin(uint16_t own, uint16_t enemy)
+    {
+        return (BITBOARD_TABLES.pairs[own] & ~BITBOARD_TABLES.lines[enemy]) != 0;
+    }
+
+    /**
+     * @brief Base 3 index of a board, digit 1 for player one's cells and 2 for player two's.
+     *
+     * @param playerOne The mask of player 1.
+     * @param playerTwo The mask of player -1.
+     * @return An index between 0 and 3^9 - 1.
+     */
+    static int ternaryIndex(uint16_t playerOne, uint16_t playerTwo)
+    {
+        return BITBOARD_TABLES.ternary[playerOne] + 2 * BITBOARD_TABLES.ternary[playerTwo];
+    }
+
+    static int popCount(uint32_t mask)
+    {
+        return __builtin_popcount(mask);
+    }
+
+    /**
+     * @brief Index of the lowest set bit. The mask must not be 0.
+     */
+    static int lowestBit(uint32_t mask)
+    {
+        return __builtin_ctz(mask);
+    }
+
+    /**
+     * @brief Index of the n-th set bit (0 based) of a 9 bit mask. n must be less than popCount(mask).
+     *
+     * One pdep where BMI2 is available, a table lookup otherwise. No loop either way.
+     */
+    static int nthSetBit(uint32_t mask, int n)
+    {
+#ifdef __BMI2__
+        return __builtin_ctz(_pdep_u32(1u << n, mask));
+#else
+        return BITBOARD_TABLES.nthBit[mask][n];
+#endif
+    }
+};
+
+#endif
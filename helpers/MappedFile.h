@@ -0,0 +1,100 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+/**
+ * @brief A read only file mapped into memory.
+ *
+ * The pages are read in by the kernel when they are first touched and are shared by
+ * every process that maps the same file, so a large table costs no heap and no load
+ * time. POSIX only.
+ */
+class MappedFile
+{
+private:
+    const uint8_t *data;
+    size_t size;
+
+public:
+    MappedFile() : data(nullptr), size(0) {}
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const char *path);
+    void close();
+
+    bool isOpen() const
+    {
+        return this->data != nullptr;
+    }
+
+    const uint8_t *getData() const
+    {
+        return this->data;
+    }
+
+    size_t getSize() const
+    {
+        return this->size;
+    }
+
+    ~MappedFile()
+    {
+        close();
+    }
+};
+
+/**
+ * @brief Maps a whole file.
+ *
+ * @param path The file.
+ * @return `true` if the file was mapped. Empty files can't be mapped.
+ */
+bool MappedFile::open(const char *path)
+{
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void *mapped = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping keeps its own reference to the file.
+    ::close(fd);
+
+    if (mapped == MAP_FAILED)
+        return false;
+
+    this->data = (const uint8_t *)mapped;
+    this->size = (size_t)info.st_size;
+
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (this->data == nullptr)
+        return;
+
+    munmap((void *)this->data, this->size);
+    this->data = nullptr;
+    this->size = 0;
+}
+
+#endif
@@ -40,7 +40,7 @@ int Menu::displayPlayerSelection(int player)
     int choice = 0;
     char symbol = (player == 1) ? this->playerSymbol->playerOne : this->playerSymbol->playerTwo;
 
-    string players[] = {"Human", "Random", "Minimax", "Mindful", "Smart", "Monte Carlo", "Advanced Minimax"};
+    string players[] = {"Human", "Random", "Minimax", "Mindful", "Smart", "Monte Carlo", "Advanced Minimax", "MCTS"};
     int totalPlayers = sizeof(players) / sizeof(players[0]);
 
     // DISPLAY THE PLAYER SELECTION MENU
@@ -0,0 +1,112 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include "./BitBoard.h"
+
+#include <cstdint>
+#include <ctime>
+
+/**
+ * @brief xoshiro256** pseudo random number generator.
+ *
+ * Much faster than rand() in the playout loops and every engine gets its own stream, so
+ * two computer players never share or reset each other's sequence. Not suitable for
+ * anything that needs cryptographic randomness.
+ */
+class Random
+{
+private:
+    uint64_t state[4];
+
+    static uint64_t rotateLeft(uint64_t value, int shift)
+    {
+        return (value << shift) | (value >> (64 - shift));
+    }
+
+public:
+    /**
+     * @brief Seeds the generator from the clock. Generators made in the same second still
+     * get different streams.
+     */
+    Random()
+    {
+        static uint64_t instances = 0;
+        seed((uint64_t)time(0) ^ (++instances * 0x9e3779b97f4a7c15ULL));
+    }
+
+    Random(uint64_t value)
+    {
+        seed(value);
+    }
+
+    static uint64_t splitMix64(uint64_t &state);
+
+    void seed(uint64_t value);
+    uint64_t next();
+    uint32_t nextInt(uint32_t bound);
+    int pickBit(uint32_t mask);
+};
+
+/**
+ * @brief splitmix64 step. Advances the state and returns the next 64 bit value.
+ */
+uint64_t Random::splitMix64(uint64_t &state)
+{
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief Restarts the generator. The same seed always gives the same sequence.
+ */
+void Random::seed(uint64_t value)
+{
+    // splitmix64 spreads the seed so the state is never all zero.
+    for (int i = 0; i < 4; i++)
+        this->state[i] = splitMix64(value);
+}
+
+/**
+ * @brief Gets the next 64 random bits.
+ */
+uint64_t Random::next()
+{
+    uint64_t *s = this->state;
+    uint64_t result = rotateLeft(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotateLeft(s[3], 45);
+
+    return result;
+}
+
+/**
+ * @brief Gets a number between 0 and bound - 1.
+ *
+ * Uses a multiply and shift instead of a division. The bias is below 2^-32 for the small
+ * bounds used here.
+ */
+uint32_t Random::nextInt(uint32_t bound)
+{
+    return (uint32_t)(((next() >> 32) * bound) >> 32);
+}
+
+/**
+ * @brief Picks one of the set bits of a 9 bit mask with a single draw.
+ *
+ * @param mask The candidates, usually the empty cells of a board. Must not be 0.
+ * @return The index of the chosen bit.
+ */
+int Random::pickBit(uint32_t mask)
+{
+    return BitBoard::nthSetBit(mask, nextInt(BitBoard::popCount(mask)));
+}
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief A fixed set of worker threads that all run the same job.
+ *
+ * The threads are started once and sleep between jobs, so a search doesn't pay for
+ * creating threads on every move. The calling thread takes part as worker 0.
+ */
+class ThreadPool
+{
+private:
+    vector<thread> threads;
+    mutex lock;
+    condition_variable jobReady;
+    condition_variable jobDone;
+    function<void(int)> job;
+    unsigned long long generation; // Bumped for every job so sleeping workers know to wake.
+    int running;                   // Workers still busy with the current job.
+    bool stopping;
+
+    void workerLoop(int worker);
+
+public:
+    ThreadPool(int numThreads);
+    ~ThreadPool();
+
+    int getNumThreads() const
+    {
+        return (int)this->threads.size() + 1;
+    }
+
+    void run(const function<void(int)> &task);
+
+    static int defaultNumThreads();
+};
+
+/**
+ * @brief Starts the worker threads.
+ *
+ * @param numThreads The total number of workers, including the calling thread.
+ */
+ThreadPool::ThreadPool(int numThreads)
+    : generation(0),
+      running(0),
+      stopping(false)
+{
+    for (int worker = 1; worker < numThreads; worker++)
+        this->threads.push_back(thread(&ThreadPool::workerLoop, this, worker));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        unique_lock<mutex> guard(this->lock);
+        this->stopping = true;
+    }
+    this->jobReady.notify_all();
+
+    for (size_t i = 0; i < this->threads.size(); i++)
+        this->threads[i].join();
+}
+
+/**
+ * @brief Runs task(worker) once on every worker and waits for all of them.
+ *
+ * Anything the workers wrote is visible to the caller once this returns.
+ *
+ * @param task The job, called with the worker index (0 to getNumThreads() - 1).
+ */
+void ThreadPool::run(const function<void(int)> &task)
+{
+    {
+        unique_lock<mutex> guard(this->lock);
+        this->job = task;
+        this->running = (int)this->threads.size();
+        this->generation++;
+    }
+    this->jobReady.notify_all();
+
+    task(0);
+
+    unique_lock<mutex> guard(this->lock);
+    this->jobDone.wait(guard, [this]
+                       { return this->running == 0; });
+}
+
+void ThreadPool::workerLoop(int worker)
+{
+    unsigned long long seen = 0;
+
+    while (true)
+    {
+        function<void(int)> task;
+        {
+            unique_lock<mutex> guard(this->lock);
+            this->jobReady.wait(guard, [this, seen]
+                                { return this->stopping || this->generation != seen; });
+
+            if (this->stopping)
+                return;
+
+            seen = this->generation;
+            task = this->job;
+        }
+
+        task(worker);
+
+        unique_lock<mutex> guard(this->lock);
+        if (--this->running == 0)
+            this->jobDone.notify_one();
+    }
+}
+
+/**
+ * @brief Number of hardware threads, or 1 if it can't be detected.
+ */
+int ThreadPool::defaultNumThreads()
+{
+    int count = (int)thread::hardware_concurrency();
+    return count > 0 ? count : 1;
+}
+
+#endif
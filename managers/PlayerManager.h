@@ -7,6 +7,7 @@
 #include "../players/HumanPlayer.h"
 #include "../players/AdvancedMinimaxPlayer.h"
 #include "../players/MonteCarloPlayer.h"
+#include "../players/MCTSPlayer.h"
 #include "../players/MinimaxPlayer.h"
 #include "../players/RandomPlayer.h"
 #include "../players/SmartPlayer.h"
@@ -14,12 +15,15 @@
 #include "../struct/Coordinate.h"
 #include "../struct/Move.h"
 #include "../struct/PlayerSymbol.h"
+#include "../struct/PlayoutPolicy.h"
+#include "../struct/SearchBudget.h"
 
 const int PM_BOARD_FULL = 9 * 9;
 const int MANAGER_PLAYER_O = 1;
 const int MANAGER_PLAYER_X = -1;
 const int DRAW = 2;
 const int MAX_NUM_SIMULATIONS = 10000;
+const int MAX_NUM_PLAYOUTS = 100000;
 const int MAX_DEPTH_LIMIT = 10;
 
 class PlayerManager
@@ -30,17 +34,31 @@ private:
     TicTacToe (*grid)[3][3];
     Coordinate *currentBoard;
     PlayerSymbol *playerSymbol;
+    ostream *statsLog;
+    int numThreads;
+    bool hasSeed;
+    uint64_t seed;
+    SearchBudget budgets[2];
+    PlayoutPolicy playoutPolicy;
+    uint64_t proofNodes;
+    size_t memoryLimit;
 
     // PRIVATE METHODS
     void checkDraw(int *gameStatus);
-    int getNumSimulations(int player);
+    int getNumSimulations(int player, const string &title = "MONTE CARLO PLAYER", int maxSimulations = MAX_NUM_SIMULATIONS);
     int getDepthLimit(int player);
 
 public:
     PlayerManager(TicTacToe (*grid)[3][3], Coordinate *currentBoard, SymbolManager *symbolManager)
         : grid(grid),
           currentBoard(currentBoard),
-          playerSymbol(symbolManager->getPlayerSymbol())
+          playerSymbol(symbolManager->getPlayerSymbol()),
+          statsLog(nullptr),
+          numThreads(1),
+          hasSeed(false),
+          seed(0),
+          proofNodes(0),
+          memoryLimit(0)
     {
     }
 
@@ -49,6 +67,13 @@ public:
     void initializePlayers(const int playerOne, const int playerTwo);
     void displayCurrentPlayer(Move player) const;
     void checkGameStatus(const int gameStatus) const;
+    void setStatsLog(ostream *log);
+    void setNumThreads(int numThreads);
+    void setSeed(uint64_t seed);
+    void setBudget(int player, const SearchBudget &budget);
+    void setPlayoutPolicy(const PlayoutPolicy &policy);
+    void setProofNodes(uint64_t maxNodes);
+    void setMemoryLimit(size_t bytes);
 
     // Destructor
     ~PlayerManager()
@@ -140,38 +165,158 @@ void PlayerManager::initializePlayers(const int playerOne, const int playerTwo)
             players[i] = new SmartPlayer(this->grid, player);
             break;
         case 6: // Monte Carlo Player
-            players[i] = new MonteCarloPlayer(this->grid, player, getNumSimulations(player));
+            players[i] = new MonteCarloPlayer(this->grid, player, this->budgets[i].isSet() ? 1 : getNumSimulations(player));
             break;
         case 7: // Advanced Minimax Player
             players[i] = new AdvancedMinimaxPlayer(this->grid, player, getDepthLimit(player));
             break;
+        case 8: // MCTS Player
+            players[i] = new MCTSPlayer(this->grid, player, this->budgets[i].isSet() ? 1 : getNumSimulations(player, "MCTS PLAYER", MAX_NUM_PLAYOUTS));
+            break;
         default:
             break;
         }
+
+        // Computer players log their search statistics if requested.
+        Algorithm *algorithm = players[i]->getAlgorithm();
+        if (algorithm == nullptr)
+            continue;
+
+        if (this->statsLog != nullptr)
+        {
+            algorithm->setStatsLog(this->statsLog);
+        }
+
+        // Threads, seed, budget, playout policy, proof search and memory cap only change the engines that use them.
+        algorithm->setNumThreads(this->numThreads);
+        algorithm->setPlayoutPolicy(this->playoutPolicy);
+        algorithm->setProofNodes(this->proofNodes);
+        if (this->memoryLimit > 0)
+        {
+            algorithm->setMemoryLimit(this->memoryLimit);
+        }
+        if (this->hasSeed)
+        {
+            algorithm->setSeed(this->seed + i);
+        }
+        if (this->budgets[i].isSet())
+        {
+            algorithm->setBudget(this->budgets[i]);
+        }
     }
 }
 
+/**
+ * @brief Logs per-move search statistics of the computer players as JSON lines.
+ *
+ * Must be called before initializePlayers().
+ *
+ * @param log The stream to write to, or nullptr to disable logging.
+ */
+void PlayerManager::setStatsLog(ostream *log)
+{
+    this->statsLog = log;
+}
+
+/**
+ * @brief Sets the number of threads the computer players may search with.
+ *
+ * Must be called before initializePlayers().
+ *
+ * @param numThreads The number of threads, 0 for one per hardware thread.
+ */
+void PlayerManager::setNumThreads(int numThreads)
+{
+    this->numThreads = numThreads;
+}
+
+/**
+ * @brief Seeds the computer players so a game can be replayed.
+ *
+ * Must be called before initializePlayers(). The second player gets seed + 1.
+ *
+ * @param seed The seed.
+ */
+void PlayerManager::setSeed(uint64_t seed)
+{
+    this->hasSeed = true;
+    this->seed = seed;
+}
+
+/**
+ * @brief Gives a player a search budget per move instead of asking for the number of simulations.
+ *
+ * Only the Monte Carlo and MCTS players use it. Must be called before initializePlayers().
+ *
+ * @param player The player, 1 or -1.
+ * @param budget The playouts and/or time per move.
+ */
+void PlayerManager::setBudget(int player, const SearchBudget &budget)
+{
+    this->budgets[player == 1 ? 0 : 1] = budget;
+}
+
+/**
+ * @brief Sets how the playouts of the Monte Carlo and MCTS players pick their moves.
+ *
+ * Must be called before initializePlayers().
+ *
+ * @param policy Random or heavy playouts.
+ */
+void PlayerManager::setPlayoutPolicy(const PlayoutPolicy &policy)
+{
+    this->playoutPolicy = policy;
+}
+
+/**
+ * @brief Lets the Advanced Minimax players prove forced wins before searching.
+ *
+ * Must be called before initializePlayers().
+ *
+ * @param maxNodes The most proof search nodes per move, 0 to turn it off.
+ */
+void PlayerManager::setProofNodes(uint64_t maxNodes)
+{
+    this->proofNodes = maxNodes;
+}
+
+/**
+ * @brief Caps the memory of the MCTS players' trees.
+ *
+ * Must be called before initializePlayers().
+ *
+ * @param bytes The most each tree may take, 0 for no cap.
+ */
+void PlayerManager::setMemoryLimit(size_t bytes)
+{
+    this->memoryLimit = bytes;
+}
+
 /**
  * @brief Gets the number of simulations
  *
  * A simply function that queries user for the number of simulations required for the Monte Claro Player.
+ * The MCTS Player uses it too, for its total number of playouts per move.
  *
+ * @param player The player, 1 or -1.
+ * @param title The heading of the prompt.
+ * @param maxSimulations The largest number accepted.
  * @return int
  */
-int PlayerManager::getNumSimulations(int player)
+int PlayerManager::getNumSimulations(int player, const string &title, int maxSimulations)
 {
     char symbol = player == 1 ? this->playerSymbol->playerOne : this->playerSymbol->playerTwo;
     int numSimulations;
 
     cout << "--------------------------------" << endl;
-    cout << "MONTE CARLO PLAYER: " << symbol << endl;
+    cout << title << ": " << symbol << endl;
     cout << "--------------------------------" << endl;
 
     // Get number of simulations
-    cout << "Enter number of simulations (1-" << MAX_NUM_SIMULATIONS << "): ";
-    while (!(cin >> numSimulations) || numSimulations < 1 || numSimulations > MAX_NUM_SIMULATIONS)
+    cout << "Enter number of simulations (1-" << maxSimulations << "): ";
+    while (!(cin >> numSimulations) || numSimulations < 1 || numSimulations > maxSimulations)
     {
-        cout << "Invalid input. Please enter a number between 1 and " << MAX_NUM_SIMULATIONS << ": ";
+        cout << "Invalid input. Please enter a number between 1 and " << maxSimulations << ": ";
         cin.clear();
         cin.ignore(1000, '\n');
     }
@@ -28,6 +28,7 @@ public:
 
     string getName() override;
     void getMove(Move *currentPlayer, const Coordinate *currentBoard) override;
+    Algorithm *getAlgorithm() override;
 };
 
 string AdvancedMinimaxPlayer::getName()
@@ -35,6 +36,11 @@ string AdvancedMinimaxPlayer::getName()
     return "Advanced Minimax";
 }
 
+Algorithm *AdvancedMinimaxPlayer::getAlgorithm()
+{
+    return &this->minimax;
+}
+
 /**
  * @brief Generates a move for computer using minimax algorithm.
  *
@@ -0,0 +1,57 @@
+#ifndef MCTSPLAYER_H
+#define MCTSPLAYER_H
+
+#include "./base/Player.h"
+#include "../TicTacToe.h"
+#include "../algorithms/montecarlo/MCTS.h"
+#include "../struct/Coordinate.h"
+#include "../struct/Move.h"
+
+using namespace std;
+
+class MCTSPlayer : public Player
+{
+private:
+    MCTS mcts;
+
+public:
+    MCTSPlayer(TicTacToe (*grid)[3][3], int player, int numPlayouts)
+        : Player(grid),
+          mcts(grid, player, numPlayouts)
+    {
+    }
+
+    string getName() override;
+    void getMove(Move *currentPlayer, const Coordinate *currentBoard) override;
+    Algorithm *getAlgorithm() override;
+};
+
+string MCTSPlayer::getName()
+{
+    return "MCTS";
+}
+
+Algorithm *MCTSPlayer::getAlgorithm()
+{
+    return &this->mcts;
+}
+
+/**
+ * @brief Generates a move for computer using Monte Carlo Tree Search.
+ *
+ * @param currentPlayer A pointer to the move to fill in.
+ * @param currentBoard A pointer to Coordinate struct that holds the position of the current select board for this game.
+ */
+void MCTSPlayer::getMove(Move *currentPlayer, const Coordinate *currentBoard)
+{
+    // Initialise temporary variables to contain the best move.
+    int bestX = 0, bestY = 0;
+
+    mcts.useAlgorithm(&bestX, &bestY, currentBoard);
+
+    // Assign the best move chosen by the algorithm to the x and y pointers.
+    currentPlayer->x = bestX;
+    currentPlayer->y = bestY;
+}
+
+#endif
@@ -21,6 +21,7 @@ public:
 
     string getName() override;
     void getMove(Move *currentPlayer, const Coordinate *currentBoard) override; 
+    Algorithm *getAlgorithm() override;
 };
 
 string MindfulPlayer::getName()
@@ -28,6 +29,11 @@ string MindfulPlayer::getName()
     return "Mindful";
 }
 
+Algorithm *MindfulPlayer::getAlgorithm()
+{
+    return &this->mindfulAlgorithm;
+}
+
 /**
  * @brief Gets the best move for computer player 'Smart Player'
  *
@@ -26,6 +26,7 @@ public:
 
     string getName() override;
     void getMove(Move *currentPlayer, const Coordinate *currentBoard) override;
+    Algorithm *getAlgorithm() override;
 };
 
 string MinimaxPlayer::getName()
@@ -33,6 +34,11 @@ string MinimaxPlayer::getName()
     return "Minimax";
 }
 
+Algorithm *MinimaxPlayer::getAlgorithm()
+{
+    return &this->minimax;
+}
+
 /**
  * @brief Generates a move for computer using minimax algorithm.
  *
@@ -24,6 +24,7 @@ public:
 
     string getName() override;
     void getMove(Move *currentPlayer, const Coordinate *currentBoard) override;
+    Algorithm *getAlgorithm() override;
 };
 
 string MonteCarloPlayer::getName()
@@ -31,6 +32,11 @@ string MonteCarloPlayer::getName()
     return "Monte Carlo";
 }
 
+Algorithm *MonteCarloPlayer::getAlgorithm()
+{
+    return &this->carlo;
+}
+
 /**
  * @brief Generates a move for computer using the Monte Carlo algorithm.
  *
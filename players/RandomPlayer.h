@@ -5,9 +5,7 @@
 #include "../TicTacToe.h"
 #include "../struct/Coordinate.h"
 #include "../struct/Move.h"
-#include "../helpers/Tools.h"
-#include <cstdlib>
-#include <ctime>
+#include "../helpers/Random.h"
 
 using namespace std;
 
@@ -19,10 +17,12 @@ using namespace std;
  */
 class RandomPlayer : public Player
 {
+private:
+    Random random;
+
 public:
     RandomPlayer(TicTacToe (*grid)[3][3]) : Player(grid)
     {
-        srand(time(0));
     };
     
     string getName() override;
@@ -44,18 +44,12 @@ string RandomPlayer::getName() {
 void RandomPlayer::getMove(Move *currentPlayer, const Coordinate *currentBoard)
 {
     TicTacToe *board = &(*this->grid)[currentBoard->x][currentBoard->y];
-    bool isValid = true;
-    int randomX = 0, randomY = 0;
 
-    // Randomly choose a position such that the choosen position is not occupied.
-    do
-    {
-        Tools::generateRandomMove(&randomX, &randomY);
-        isValid = board->isValidMove(randomX, randomY);
-    } while (!isValid);
+    // Randomly choose one of the empty cells.
+    int cell = this->random.pickBit(board->getEmptyMask());
 
-    currentPlayer->x = randomX;
-    currentPlayer->y = randomY;
+    currentPlayer->x = cell / 3;
+    currentPlayer->y = cell % 3;
 }
 
 #endif
\ No newline at end of file
@@ -21,12 +21,18 @@ public:
 
     string getName() override;
     void getMove(Move *currentPlayer, const Coordinate *currentBoard) override;
+    Algorithm *getAlgorithm() override;
 };
 
 string SmartPlayer::getName() {
     return "Smart";
 }
 
+Algorithm *SmartPlayer::getAlgorithm()
+{
+    return &this->smart;
+}
+
 /**
  * @brief Gets the best move for computer player 'Smart Player'
  *
@@ -4,6 +4,7 @@
 #include "../../TicTacToe.h"
 #include "../../struct/Coordinate.h"
 #include "../../struct/Move.h"
+#include "../../algorithms/base/Algorithm.h"
 #include <iostream>
 
 using namespace std;
@@ -16,6 +17,9 @@ protected:
 public:
     Player(TicTacToe (*grid)[3][3]) : grid(grid) {}
 
+    // Players are deleted through this class, so the engines they own must be destroyed too.
+    virtual ~Player() {}
+
     /**
      * @brief Base function for the abstract class Player
      *
@@ -26,6 +30,16 @@ public:
      */
     virtual void getMove(Move *currentPlayer, const Coordinate *currentBoard) = 0;
     virtual string getName() = 0;
+
+    /**
+     * @brief Gets the algorithm behind a computer player.
+     *
+     * @return A pointer to the algorithm, or nullptr for players without one.
+     */
+    virtual Algorithm *getAlgorithm()
+    {
+        return nullptr;
+    }
 };
 
 #endif
@@ -1,5 +1,5 @@
-#ifndef move
-#define move
+#ifndef MOVE_H
+#define MOVE_H
 
 /**
  * @brief Struct to manage player movements.
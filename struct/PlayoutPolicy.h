@@ -0,0 +1,53 @@
+#ifndef PLAYOUTPOLICY_H
+#define PLAYOUTPOLICY_H
+
+#include <cstdlib>
+
+/**
+ * @brief How the playouts of a sampling engine pick their moves.
+ *
+ * Light playouts play uniformly random moves. Heavy playouts take a cell that wins the
+ * board, else block the enemy's winning cell, else lean towards the centre and the
+ * corners like HeuristicSearch. With probability epsilon a heavy step plays a random move
+ * instead, so the playouts still cover the whole game.
+ *
+ * @param heavy = whether the playouts are heavy
+ * @param epsilon = share of random moves in a heavy playout
+ */
+struct PlayoutPolicy
+{
+    bool heavy;
+    double epsilon;
+
+    PlayoutPolicy()
+        : heavy(false),
+          epsilon(0.5)
+    {
+    }
+
+    PlayoutPolicy(bool heavy, double epsilon)
+        : heavy(heavy),
+          epsilon(epsilon)
+    {
+    }
+
+    /**
+     * @brief Reads the epsilon of a heavy policy, a number from 0 to 1 like "0.25".
+     *
+     * @param text The text to read.
+     * @param policy Receives a heavy policy with that epsilon.
+     * @return false if the text isn't a number from 0 to 1.
+     */
+    static bool parse(const char *text, PlayoutPolicy *policy)
+    {
+        char *end;
+        double epsilon = strtod(text, &end);
+        if (end == text || *end != '\0' || !(epsilon >= 0 && epsilon <= 1))
+            return false;
+
+        *policy = PlayoutPolicy(true, epsilon);
+        return true;
+    }
+};
+
+#endif
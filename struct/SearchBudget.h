@@ -0,0 +1,99 @@
+#ifndef SEARCHBUDGET_H
+#define SEARCHBUDGET_H
+
+#include <cstdlib>
+#include <cstring>
+
+/**
+ * @brief How much work a sampling engine may spend on one move.
+ *
+ * Either limit may be left at 0 (no limit). With both set the search stops at whichever
+ * runs out first.
+ *
+ * @param playouts = total playouts per move, over all candidate moves
+ * @param milliseconds = wall-clock time per move
+ */
+struct SearchBudget
+{
+    long long playouts;
+    double milliseconds;
+
+    SearchBudget()
+        : playouts(0),
+          milliseconds(0)
+    {
+    }
+
+    SearchBudget(long long playouts, double milliseconds)
+        : playouts(playouts),
+          milliseconds(milliseconds)
+    {
+    }
+
+    bool isSet() const
+    {
+        return this->playouts > 0 || this->milliseconds > 0;
+    }
+
+    /**
+     * @brief Checks if the budget is used up.
+     *
+     * @param done The playouts played so far.
+     * @param elapsedMs The time spent so far.
+     */
+    bool isExhausted(long long done, double elapsedMs) const
+    {
+        return (this->playouts > 0 && done >= this->playouts) ||
+               (this->milliseconds > 0 && elapsedMs >= this->milliseconds);
+    }
+
+    /**
+     * @brief Reads a budget like "20000", "250ms" or "20000,250ms".
+     *
+     * The playouts must be a whole number, the milliseconds may have a fraction.
+     *
+     * @param text The text to read.
+     * @param budget Receives the budget.
+     * @return false if the text isn't a valid budget.
+     */
+    static bool parse(const char *text, SearchBudget *budget)
+    {
+        SearchBudget result;
+
+        while (*text != '\0')
+        {
+            char *end;
+            double value = strtod(text, &end);
+            if (end == text || value <= 0)
+                return false;
+
+            if (strncmp(end, "ms", 2) == 0)
+            {
+                result.milliseconds = value;
+                end += 2;
+            }
+            else
+            {
+                // Playouts come whole, "0.5" or "20000.7" is a typo rather than a budget.
+                if (value != (double)(long long)value)
+                    return false;
+                result.playouts = (long long)value;
+            }
+
+            if (*end == ',')
+                end++;
+            else if (*end != '\0')
+                return false;
+
+            text = end;
+        }
+
+        if (!result.isSet())
+            return false;
+
+        *budget = result;
+        return true;
+    }
+};
+
+#endif
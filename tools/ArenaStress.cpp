@@ -0,0 +1,180 @@
+/*
+ * ArenaStress.cpp
+ *
+ * Keeps an MCTS arena (see algorithms/montecarlo/MCTSArena.h) full through many prune
+ * cycles, the way a long search under a memory cap does, and checks after every cycle
+ * that no node or edge block is handed out twice.
+ *
+ * Build: g++ -O2 -o arena_stress tools/ArenaStress.cpp
+ * Usage: arena_stress [cycles] [nodes]
+ *
+ * Every cycle grows a random tree until an allocation fails, then prunes it to a small
+ * part of the arena. Most nodes take the largest edge block (a redirect with every cell
+ * empty), so the free lists serve as many edges as they can per cycle: with the defaults
+ * more than 2^32 edges are allocated over the run, enough to wrap a pool counter that
+ * kept counting once the pool was used up. Exits with 1 on the first broken cycle.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+
+#include "../algorithms/montecarlo/MCTSArena.h"
+#include "../helpers/Random.h"
+
+const int ARENA_STRESS_DEFAULT_CYCLES = 100000;
+const uint32_t ARENA_STRESS_DEFAULT_NODES = 8192;
+const uint32_t ARENA_STRESS_KEEP_SHARE = 64;        // A prune keeps this share (1 / n) of the nodes.
+const uint32_t ARENA_STRESS_ROOT_VISITS = 1u << 30;
+const uint64_t ARENA_STRESS_SEED = 0x4172656e61ULL; // "Arena"
+const int ARENA_STRESS_PROGRESS = 20000;           // Cycles between progress lines.
+
+/**
+ * @brief Takes a fresh node with fewer visits than its parent, as the search leaves them.
+ */
+uint32_t addNode(MCTSArena &arena, uint32_t parentVisits, Random &random)
+{
+    uint32_t index = arena.allocateNode();
+    if (index != MCTS_NONE)
+        arena.node(index).visits.store(random.nextInt(parentVisits), memory_order_relaxed);
+    return index;
+}
+
+/**
+ * @brief Gives a node its edges. Most get a full redirect block, the others a single board.
+ *
+ * @return `false` if the edge pool and free lists are used up.
+ */
+bool expand(MCTSArena &arena, uint32_t index, Random &random)
+{
+    uint32_t count = random.nextInt(4) ? MCTS_MAX_EDGES : 1 + random.nextInt(MCTS_EDGES_PER_NODE);
+    uint32_t first = arena.allocateEdges(count);
+    if (first == MCTS_NONE)
+        return false;
+
+    for (uint32_t j = first; j < first + count; j++)
+        arena.edge(j).child.store(MCTS_NONE, memory_order_relaxed);
+
+    MCTSNode &node = arena.node(index);
+    node.firstEdge = first;
+    node.numEdges = (uint8_t)count;
+    node.state.store(MCTS_EXPANDED, memory_order_relaxed);
+    return true;
+}
+
+/**
+ * @brief Adds nodes along random paths from the root until an allocation fails.
+ */
+void grow(MCTSArena &arena, uint32_t root, Random &random)
+{
+    while (true)
+    {
+        uint32_t index = root;
+        while (arena.node(index).state.load(memory_order_relaxed) == MCTS_EXPANDED)
+        {
+            MCTSNode &node = arena.node(index);
+            MCTSEdge &edge = arena.edge(node.firstEdge + random.nextInt(node.numEdges));
+            uint32_t child = edge.child.load(memory_order_relaxed);
+            if (child == MCTS_NONE)
+            {
+                child = addNode(arena, node.visits.load(memory_order_relaxed) + 1, random);
+                if (child == MCTS_NONE)
+                    return;
+                edge.child.store(child, memory_order_relaxed);
+            }
+            index = child;
+        }
+
+        if (!expand(arena, index, random))
+            return;
+    }
+}
+
+/**
+ * @brief Checks that the nodes reachable from the root are in range and own their edge blocks alone.
+ *
+ * @return A description of the first problem, or nullptr.
+ */
+const char *check(MCTSArena &arena, uint32_t root, uint32_t maxNodes)
+{
+    size_t numEdges = (size_t)maxNodes * MCTS_EDGES_PER_NODE;
+    vector<uint8_t> nodeSeen(maxNodes, 0), edgeSeen(numEdges, 0);
+    vector<uint32_t> stack(1, root);
+    nodeSeen[root] = 1;
+
+    while (!stack.empty())
+    {
+        MCTSNode &node = arena.node(stack.back());
+        stack.pop_back();
+        if (node.state.load(memory_order_relaxed) != MCTS_EXPANDED)
+            continue;
+
+        size_t first = node.firstEdge, size = MCTSArena::getBlockSize(node.numEdges);
+        if (first + size > numEdges)
+            return "an edge block is out of range";
+        for (size_t j = first; j < first + size; j++)
+        {
+            if (edgeSeen[j]++)
+                return "an edge block was handed out twice";
+        }
+
+        for (size_t j = first; j < first + node.numEdges; j++)
+        {
+            uint32_t child = arena.edge(j).child.load(memory_order_relaxed);
+            if (child == MCTS_NONE)
+                continue;
+            if (child >= maxNodes)
+                return "a node is out of range";
+            if (nodeSeen[child]++)
+                return "a node was handed out twice";
+            stack.push_back(child);
+        }
+    }
+
+    if (arena.getNodeCount() > maxNodes || arena.getEdgeCount() > numEdges)
+        return "the pool counters passed the capacity";
+    return nullptr;
+}
+
+int main(int argc, char *argv[])
+{
+    int cycles = argc > 1 ? atoi(argv[1]) : ARENA_STRESS_DEFAULT_CYCLES;
+    uint32_t maxNodes = argc > 2 ? (uint32_t)atoi(argv[2]) : ARENA_STRESS_DEFAULT_NODES;
+    if (cycles < 1 || maxNodes < 2)
+    {
+        cerr << "Usage: " << argv[0] << " [cycles] [nodes], with at least 1 cycle and 2 nodes" << endl;
+        return 1;
+    }
+
+    MCTSArena arena(maxNodes);
+    Random random(ARENA_STRESS_SEED);
+    uint32_t root = arena.allocateNode();
+    arena.node(root).visits.store(ARENA_STRESS_ROOT_VISITS, memory_order_relaxed);
+
+    uint64_t freed = 0;
+    for (int cycle = 1; cycle <= cycles; cycle++)
+    {
+        grow(arena, root, random);
+        if (!arena.isFull())
+        {
+            printf("Cycle %d: the arena didn't fill up\n", cycle);
+            return 1;
+        }
+
+        const char *problem = check(arena, root, maxNodes);
+        if (problem != nullptr)
+        {
+            printf("Cycle %d: %s\n", cycle, problem);
+            return 1;
+        }
+
+        freed += arena.prune(root, maxNodes / ARENA_STRESS_KEEP_SHARE + 1);
+        if (cycle % ARENA_STRESS_PROGRESS == 0)
+            printf("%d cycles, %llu nodes freed\n", cycle, (unsigned long long)freed);
+    }
+
+    printf("OK: %d cycles, %llu nodes freed\n", cycles, (unsigned long long)freed);
+    return 0;
+}
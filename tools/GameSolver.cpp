@@ -0,0 +1,579 @@
+/*
+ * GameSolver.cpp
+ *
+ * Works towards the game theoretic value of the game: which player, if any, can force a
+ * win from the start, whatever boards the random redirects pick. What it settles is
+ * written to a proof database (see algorithms/minimax/ProofDatabase.h) that the proof
+ * number search of the engines reads.
+ *
+ * Build: g++ -O2 -pthread -o game_solver tools/GameSolver.cpp
+ * Usage: game_solver <database file> [plies] [nodes per position] [threads] [table MB per thread]
+ *
+ * The positions with [plies] pieces are listed, one of each set of symmetric ones, and
+ * [threads] workers (0 = one per core) take them one at a time. Each is searched by a
+ * df-pn search of up to [nodes per position] nodes, first for a win of the player to
+ * move and then, unless that was proven, for a win of the opponent. The positions above
+ * them are then settled from these by minimax, which gives the value of the start.
+ *
+ * Every searched position is appended to <database file>.log as soon as it is done.
+ * Every minute the log is synced to disk, the progress printed in positions and search
+ * states per second, and the database rewritten from the log. A run that is killed
+ * starts again where the log ends, skipping the positions already settled or already
+ * searched with as many nodes. Running it again with more nodes retries the ones left
+ * open.
+ *
+ * The df-pn transposition tables stay in memory, one per worker, and are lost with the
+ * process. What outlives them are the proofs: every node a search proves or disproves
+ * under at least GAME_SOLVER_SETTLED_MIN_WORK nodes is logged too, and the database,
+ * rebuilt from the log at startup, is read by the searches of the run. So a position
+ * that one worker settled on the way is not searched again by another, nor after a kill,
+ * but the open part of a search is.
+ *
+ * The tree grows about 8 times with every ply: 4 plies give 6920 positions, 6 plies
+ * 481436. Neither player is expected to have a forced win from the start, so the
+ * interesting output is how much of the tree below it is settled.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <unistd.h>
+
+using namespace std;
+
+#include "../algorithms/minimax/ProofNumberSearch.h"
+#include "../helpers/ThreadPool.h"
+
+const int GAME_SOLVER_DEFAULT_PLIES = 4;
+const uint64_t GAME_SOLVER_DEFAULT_NODES = 1000000;
+const int GAME_SOLVER_DEFAULT_TABLE_MB = 64;
+const double GAME_SOLVER_CHECKPOINT_SECONDS = 60;
+const uint32_t GAME_SOLVER_SETTLED_MIN_WORK = 1000; // Nodes under a proof worth logging.
+
+// Both questions about a position are answered once one flag of each pair is set.
+const uint8_t GAME_SOLVER_WIN_KNOWN = PROOF_DATABASE_WIN | PROOF_DATABASE_NO_WIN;
+const uint8_t GAME_SOLVER_LOSS_KNOWN = PROOF_DATABASE_LOSS | PROOF_DATABASE_NO_LOSS;
+
+/**
+ * @brief One searched position in the log.
+ *
+ * @param key The canonical hash of the position.
+ * @param maxNodes The nodes each search was allowed, to know when a retry could help, 0
+ *                 for a position settled inside the search of another.
+ * @param flags What the searches settled, PROOF_DATABASE_* for the player to move.
+ * @param pieces The pieces on the grid.
+ */
+struct GameSolverRecord
+{
+    uint64_t key;
+    uint32_t maxNodes;
+    uint8_t flags;
+    uint8_t pieces;
+    uint8_t reserved[2];
+};
+
+static_assert(sizeof(GameSolverRecord) == 16, "GameSolverRecord must stay 16 bytes");
+
+/**
+ * @brief The log, the solved positions and the progress, shared by the workers.
+ */
+struct GameSolverState
+{
+    mutex lock;
+    FILE *log;
+    const char *path;
+    int plies;
+    map<uint64_t, GameSolverRecord> records; // By canonical hash.
+    size_t total;
+    size_t done;
+    uint64_t nodes;
+    chrono::steady_clock::time_point start;
+    chrono::steady_clock::time_point lastCheckpoint;
+    bool checkpointing; // A worker is writing a checkpoint.
+};
+
+/**
+ * @brief Lists the positions with the given number of pieces, one of each set of symmetric ones.
+ */
+void getFrontier(int plies, vector<Position> &frontier)
+{
+    map<uint64_t, Position> level;
+    for (int b = 0; b < POSITION_NUM_BOARDS; b++)
+    {
+        TicTacToe grid[3][3];
+        Coordinate start(b / 3, b % 3);
+        Position position = Position::fromGrid(&grid, &start, 1);
+
+        int symmetry;
+        level[Symmetry::canonicalHash(position, symmetry)] = position;
+    }
+
+    for (int ply = 0; ply < plies; ply++)
+    {
+        map<uint64_t, Position> next;
+        for (map<uint64_t, Position>::const_iterator it = level.begin(); it != level.end(); ++it)
+        {
+            // A redirect is resolved before the move, so its positions get the same number of pieces.
+            Position boards[POSITION_NUM_BOARDS];
+            int numBoards = 0;
+            if (it->second.board == POSITION_ANY_BOARD)
+            {
+                for (uint16_t open = it->second.openBoards(); open; open &= open - 1)
+                {
+                    boards[numBoards] = it->second;
+                    boards[numBoards++].setBoard(BitBoard::lowestBit(open));
+                }
+            }
+            else
+                boards[numBoards++] = it->second;
+
+            for (int i = 0; i < numBoards; i++)
+            {
+                for (uint16_t empty = boards[i].emptyCells(boards[i].board); empty; empty &= empty - 1)
+                {
+                    Position child = boards[i];
+                    child.play(child.board, BitBoard::lowestBit(empty));
+                    if (!child.isRunning())
+                        continue;
+
+                    int symmetry;
+                    next[Symmetry::canonicalHash(child, symmetry)] = child;
+                }
+            }
+        }
+        level.swap(next);
+    }
+
+    for (map<uint64_t, Position>::const_iterator it = level.begin(); it != level.end(); ++it)
+        frontier.push_back(it->second);
+}
+
+/**
+ * @brief Turns flags for the player to move into flags for player 1.
+ *
+ * The same mapping turns them back.
+ */
+uint8_t getPlayerOneFlags(uint8_t flags, int toMove)
+{
+    if (toMove == 1)
+        return flags;
+    return (uint8_t)((flags & GAME_SOLVER_WIN_KNOWN) << 2 | (flags & GAME_SOLVER_LOSS_KNOWN) >> 2);
+}
+
+/**
+ * @brief Settles a position from the searched positions below it, by minimax.
+ *
+ * A player wins from a node where it moves if it wins after some move, and from any
+ * other node (the opponent's move or a redirect) if it wins after all of them. It
+ * fails to win in the opposite cases.
+ *
+ * @param position The position, with at most `plies` pieces.
+ * @param plies The pieces of the searched positions.
+ * @param records The searched positions.
+ * @param settled Receives the flags of the positions above the searched ones.
+ * @return The PROOF_DATABASE_* flags of the position, for the player to move.
+ */
+uint8_t getFlags(const Position &position, int plies, const map<uint64_t, GameSolverRecord> &records,
+                 map<uint64_t, uint8_t> &settled)
+{
+    if (!position.isRunning())
+    {
+        if (position.status == POSITION_DRAW)
+            return PROOF_DATABASE_NO_WIN | PROOF_DATABASE_NO_LOSS;
+        return position.status == position.toMove ? PROOF_DATABASE_WIN | PROOF_DATABASE_NO_LOSS
+                                                  : PROOF_DATABASE_LOSS | PROOF_DATABASE_NO_WIN;
+    }
+
+    int symmetry;
+    uint64_t key = Symmetry::canonicalHash(position, symmetry);
+    if (position.filled >= plies)
+    {
+        map<uint64_t, GameSolverRecord>::const_iterator found = records.find(key);
+        return found == records.end() ? 0 : found->second.flags;
+    }
+
+    map<uint64_t, uint8_t>::const_iterator found = settled.find(key);
+    if (found != settled.end())
+        return found->second;
+
+    // Player 1 flags over the children: "some" for OR nodes, "all" for AND nodes.
+    uint8_t some = 0, all = PROOF_DATABASE_WIN | PROOF_DATABASE_NO_WIN | PROOF_DATABASE_LOSS | PROOF_DATABASE_NO_LOSS;
+    if (position.board == POSITION_ANY_BOARD)
+    {
+        for (uint16_t open = position.openBoards(); open; open &= open - 1)
+        {
+            Position child = position;
+            child.setBoard(BitBoard::lowestBit(open));
+            uint8_t flags = getPlayerOneFlags(getFlags(child, plies, records, settled), child.toMove);
+            some |= flags;
+            all &= flags;
+        }
+    }
+    else
+    {
+        for (uint16_t empty = position.emptyCells(position.board); empty; empty &= empty - 1)
+        {
+            Position child = position;
+            child.play(position.board, BitBoard::lowestBit(empty));
+            uint8_t flags = getPlayerOneFlags(getFlags(child, plies, records, settled), child.toMove);
+            some |= flags;
+            all &= flags;
+        }
+    }
+
+    // The mover's win needs one winning move and its failure every move; the opponent
+    // is the other way round. A redirect is an AND node for both players.
+    bool oneMoves = position.toMove == 1 && position.board != POSITION_ANY_BOARD;
+    bool twoMoves = position.toMove == -1 && position.board != POSITION_ANY_BOARD;
+    uint8_t flags = (uint8_t)(((oneMoves ? some : all) & PROOF_DATABASE_WIN) |
+                              ((oneMoves ? all : some) & PROOF_DATABASE_NO_WIN) |
+                              ((twoMoves ? some : all) & PROOF_DATABASE_LOSS) |
+                              ((twoMoves ? all : some) & PROOF_DATABASE_NO_LOSS));
+    flags = getPlayerOneFlags(flags, position.toMove);
+
+    settled[key] = flags;
+    return flags;
+}
+
+/**
+ * @brief Writes the proof database: the searched positions and the ones settled above them.
+ *
+ * It is written next to the file and renamed over it, so a reader never sees half a file.
+ *
+ * @param path The database file.
+ * @param plies The pieces of the searched positions.
+ * @param records The searched positions and the ones settled inside their searches.
+ * @return The flags of the 9 start positions, for player 1.
+ */
+bool writeDatabase(const char *path, int plies, const map<uint64_t, GameSolverRecord> &records,
+                   uint8_t startFlags[POSITION_NUM_BOARDS])
+{
+    map<uint64_t, uint8_t> settled;
+    for (int b = 0; b < POSITION_NUM_BOARDS; b++)
+    {
+        TicTacToe grid[3][3];
+        Coordinate start(b / 3, b % 3);
+        startFlags[b] = getFlags(Position::fromGrid(&grid, &start, 1), plies, records, settled);
+    }
+
+    int maxPieces = plies;
+    for (map<uint64_t, GameSolverRecord>::const_iterator it = records.begin(); it != records.end(); ++it)
+    {
+        settled[it->first] = it->second.flags;
+        maxPieces = max(maxPieces, (int)it->second.pieces);
+    }
+
+    vector<uint64_t> keys;
+    vector<uint8_t> flags;
+    for (map<uint64_t, uint8_t>::const_iterator it = settled.begin(); it != settled.end(); ++it)
+    {
+        if (it->second == 0)
+            continue;
+        keys.push_back(it->first);
+        flags.push_back(it->second);
+    }
+
+    string temporary = string(path) + ".tmp";
+    FILE *file = fopen(temporary.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+
+    ProofDatabaseHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = PROOF_DATABASE_MAGIC;
+    header.version = PROOF_DATABASE_VERSION;
+    header.keySize = sizeof(uint64_t);
+    header.flagSize = sizeof(uint8_t);
+    header.maxPieces = (uint32_t)maxPieces;
+    header.count = keys.size();
+
+    // The map kept the keys sorted.
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   fwrite(keys.data(), sizeof(uint64_t), keys.size(), file) == keys.size() &&
+                   fwrite(flags.data(), sizeof(uint8_t), flags.size(), file) == flags.size();
+    written = fclose(file) == 0 && written;
+
+    return written && rename(temporary.c_str(), path) == 0;
+}
+
+/**
+ * @brief Describes the flags of a start position.
+ */
+const char *describe(uint8_t flags)
+{
+    if (flags & PROOF_DATABASE_WIN)
+        return "player 1 forces a win";
+    if (flags & PROOF_DATABASE_LOSS)
+        return "player -1 forces a win";
+    if ((flags & PROOF_DATABASE_NO_WIN) && (flags & PROOF_DATABASE_NO_LOSS))
+        return "neither player can force a win";
+    return "unknown";
+}
+
+/**
+ * @brief Syncs the log to disk, prints the progress and rewrites the database.
+ *
+ * Called with the state locked. The records are copied and the lock released while the
+ * database is written, so the other workers can go on logging.
+ */
+void checkpoint(GameSolverState &state, unique_lock<mutex> &guard)
+{
+    state.checkpointing = true;
+    state.lastCheckpoint = chrono::steady_clock::now();
+    fflush(state.log);
+
+    map<uint64_t, GameSolverRecord> records = state.records;
+    size_t done = state.done;
+    uint64_t nodes = state.nodes;
+    double seconds = chrono::duration<double>(state.lastCheckpoint - state.start).count();
+    guard.unlock();
+
+    // Only what was flushed above has to reach the disk before the database does.
+    fsync(fileno(state.log));
+    uint8_t startFlags[POSITION_NUM_BOARDS];
+    bool written = writeDatabase(state.path, state.plies, records, startFlags);
+
+    printf("%zu / %zu positions, %.0f states/s, %.0f s%s\n", done, state.total,
+           seconds > 0 ? nodes / seconds : 0.0, seconds, written ? "" : ", could not write the database");
+    fflush(stdout);
+
+    guard.lock();
+    state.checkpointing = false;
+}
+
+/**
+ * @brief Logs what a search settled, unless it is known already.
+ *
+ * Called with the state locked.
+ */
+void logRecord(GameSolverState &state, GameSolverRecord record)
+{
+    map<uint64_t, GameSolverRecord>::iterator found = state.records.find(record.key);
+    if (found != state.records.end())
+    {
+        if ((found->second.flags | record.flags) == found->second.flags && found->second.maxNodes >= record.maxNodes)
+            return;
+        record.flags |= found->second.flags;
+        record.maxNodes = max(record.maxNodes, found->second.maxNodes);
+    }
+
+    // Flushed at once, so killing the process loses no finished search.
+    fwrite(&record, sizeof(record), 1, state.log);
+    fflush(state.log);
+    state.records[record.key] = record;
+}
+
+/**
+ * @brief Searches one position, both for a win of the player to move and of the opponent.
+ */
+GameSolverRecord solvePosition(ProofNumberSearch &prover, const Position &position, uint64_t key, uint8_t flags, uint64_t maxNodes, uint64_t &nodes)
+{
+    GameSolverRecord record;
+    memset(&record, 0, sizeof(record));
+    record.key = key;
+    record.maxNodes = (uint32_t)min(maxNodes, (uint64_t)UINT32_MAX);
+    record.pieces = (uint8_t)position.filled;
+
+    if (!(flags & GAME_SOLVER_WIN_KNOWN))
+    {
+        ProofResult result = prover.solve(position, position.toMove, maxNodes);
+        nodes += result.nodes;
+        if (result.status == PNS_PROVEN)
+            flags |= PROOF_DATABASE_WIN | PROOF_DATABASE_NO_LOSS;
+        else if (result.status == PNS_DISPROVEN)
+            flags |= PROOF_DATABASE_NO_WIN;
+    }
+
+    if (!(flags & GAME_SOLVER_LOSS_KNOWN))
+    {
+        ProofResult result = prover.solve(position, -position.toMove, maxNodes);
+        nodes += result.nodes;
+        if (result.status == PNS_PROVEN)
+            flags |= PROOF_DATABASE_LOSS | PROOF_DATABASE_NO_WIN;
+        else if (result.status == PNS_DISPROVEN)
+            flags |= PROOF_DATABASE_NO_LOSS;
+    }
+
+    record.flags = flags;
+    return record;
+}
+
+/**
+ * @brief Reads the log of an earlier run, dropping a record cut short by a kill.
+ *
+ * @return The number of records read.
+ */
+size_t readLog(const string &path, map<uint64_t, GameSolverRecord> &records)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr)
+        return 0;
+
+    GameSolverRecord record;
+    size_t count = 0;
+    while (fread(&record, sizeof(record), 1, file) == 1)
+    {
+        // A position is logged again when more of it is settled, or searched with more nodes.
+        map<uint64_t, GameSolverRecord>::iterator found = records.find(record.key);
+        if (found != records.end())
+        {
+            record.flags |= found->second.flags;
+            record.maxNodes = max(record.maxNodes, found->second.maxNodes);
+        }
+        records[record.key] = record;
+        count++;
+    }
+    fclose(file);
+
+    if (truncate(path.c_str(), (off_t)(count * sizeof(GameSolverRecord))) != 0)
+        cerr << "Could not truncate " << path << endl;
+
+    return count;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        cerr << "Usage: " << argv[0] << " <database file> [plies] [nodes per position] [threads] [table MB per thread]" << endl;
+        return 1;
+    }
+
+    int plies = argc > 2 ? atoi(argv[2]) : GAME_SOLVER_DEFAULT_PLIES;
+    uint64_t maxNodes = argc > 3 ? strtoull(argv[3], nullptr, 10) : GAME_SOLVER_DEFAULT_NODES;
+    int numThreads = argc > 4 ? atoi(argv[4]) : 0;
+    int tableMb = argc > 5 ? atoi(argv[5]) : GAME_SOLVER_DEFAULT_TABLE_MB;
+    if (plies < 0 || plies >= POSITION_NUM_MOVES || maxNodes < 1 || tableMb < 1)
+    {
+        cerr << "The plies must be 0 to 80, the nodes and table size at least 1" << endl;
+        return 1;
+    }
+
+    GameSolverState state;
+    state.path = argv[1];
+    state.plies = plies;
+    state.done = 0;
+    state.nodes = 0;
+    state.checkpointing = false;
+
+    string logPath = string(argv[1]) + ".log";
+    size_t resumed = readLog(logPath, state.records);
+
+    // The searches read what earlier runs settled, also below the listed positions.
+    uint8_t startFlags[POSITION_NUM_BOARDS];
+    if (resumed > 0 && (!writeDatabase(state.path, plies, state.records, startFlags) || !ProofDatabase::instance().open(state.path)))
+        cerr << "Could not read back " << argv[1] << ", searching without it" << endl;
+
+    vector<Position> frontier;
+    getFrontier(plies, frontier);
+
+    // Positions left to search, with what is already known about them.
+    vector<Position> jobs;
+    vector<uint8_t> known;
+    for (size_t i = 0; i < frontier.size(); i++)
+    {
+        int symmetry;
+        map<uint64_t, GameSolverRecord>::const_iterator found = state.records.find(Symmetry::canonicalHash(frontier[i], symmetry));
+        uint8_t flags = found == state.records.end() ? 0 : found->second.flags;
+        bool settled = (flags & GAME_SOLVER_WIN_KNOWN) && (flags & GAME_SOLVER_LOSS_KNOWN);
+        if (settled || (found != state.records.end() && found->second.maxNodes >= maxNodes))
+            continue;
+
+        jobs.push_back(frontier[i]);
+        known.push_back(flags);
+    }
+
+    printf("%zu positions with %d pieces, %zu read from %s, %zu to search\n", frontier.size(), plies, resumed,
+           logPath.c_str(), jobs.size());
+    fflush(stdout);
+
+    state.log = fopen(logPath.c_str(), "ab");
+    if (state.log == nullptr)
+    {
+        cerr << "Could not open " << logPath << endl;
+        return 1;
+    }
+
+    ThreadPool pool(numThreads < 1 ? ThreadPool::defaultNumThreads() : numThreads);
+    vector<ProofNumberSearch> provers(pool.getNumThreads(), ProofNumberSearch((size_t)tableMb << 20));
+    vector<vector<ProofSettled>> settled(pool.getNumThreads());
+    for (size_t w = 0; w < provers.size(); w++)
+        provers[w].setSettledLog(&settled[w], GAME_SOLVER_SETTLED_MIN_WORK);
+    state.total = jobs.size();
+    state.start = state.lastCheckpoint = chrono::steady_clock::now();
+
+    // Workers take the positions one at a time, their search times differ a lot.
+    atomic<size_t> next(0);
+    pool.run([&](int worker)
+             {
+                 for (size_t i = next++; i < jobs.size(); i = next++)
+                 {
+                     int symmetry;
+                     uint64_t key = Symmetry::canonicalHash(jobs[i], symmetry);
+                     uint8_t flags = known[i];
+                     {
+                         // Another search may have settled some of it since the start.
+                         lock_guard<mutex> guard(state.lock);
+                         map<uint64_t, GameSolverRecord>::const_iterator found = state.records.find(key);
+                         if (found != state.records.end())
+                             flags |= found->second.flags;
+                     }
+
+                     uint64_t nodes = 0;
+                     GameSolverRecord record = solvePosition(provers[worker], jobs[i], key, flags, maxNodes, nodes);
+
+                     unique_lock<mutex> guard(state.lock);
+                     for (size_t s = 0; s < settled[worker].size(); s++)
+                     {
+                         GameSolverRecord inner;
+                         memset(&inner, 0, sizeof(inner));
+                         inner.key = settled[worker][s].key;
+                         inner.flags = settled[worker][s].flags;
+                         inner.pieces = settled[worker][s].pieces;
+                         logRecord(state, inner);
+                     }
+                     settled[worker].clear();
+                     logRecord(state, record);
+                     state.done++;
+                     state.nodes += nodes;
+
+                     double sinceCheckpoint = chrono::duration<double>(chrono::steady_clock::now() - state.lastCheckpoint).count();
+                     if (sinceCheckpoint >= GAME_SOLVER_CHECKPOINT_SECONDS && !state.checkpointing)
+                         checkpoint(state, guard);
+                 } });
+
+    {
+        unique_lock<mutex> guard(state.lock);
+        checkpoint(state, guard);
+    }
+    fclose(state.log);
+
+    uint64_t wins = 0, losses = 0, open = 0;
+    for (size_t i = 0; i < frontier.size(); i++)
+    {
+        int symmetry;
+        uint8_t flags = state.records[Symmetry::canonicalHash(frontier[i], symmetry)].flags;
+        wins += (flags & PROOF_DATABASE_WIN) != 0;
+        losses += (flags & PROOF_DATABASE_LOSS) != 0;
+        open += !(flags & (PROOF_DATABASE_WIN | PROOF_DATABASE_LOSS)) &&
+                !((flags & PROOF_DATABASE_NO_WIN) && (flags & PROOF_DATABASE_NO_LOSS));
+    }
+    printf("With %d pieces: %llu won and %llu lost for the player to move, %llu open\n", plies,
+           (unsigned long long)wins, (unsigned long long)losses, (unsigned long long)open);
+
+    if (!writeDatabase(state.path, plies, state.records, startFlags))
+    {
+        cerr << "Could not write " << argv[1] << endl;
+        return 1;
+    }
+
+    for (int b = 0; b < POSITION_NUM_BOARDS; b++)
+        printf("Start on board %d: %s\n", b, describe(startFlags[b]));
+    printf("Wrote %s\n", argv[1]);
+    return 0;
+}
@@ -0,0 +1,283 @@
+/*
+ * PlayoutBench.cpp
+ *
+ * Measures the playout speed of the Monte Carlo engines on a fixed set of positions.
+ * The positions are made by random play from a fixed seed, so runs can be compared.
+ *
+ * Build: g++ -O2 -pthread -o playout_bench tools/PlayoutBench.cpp
+ * Usage: playout_bench [--heavy] [positions] [playouts per move] [threads]
+ *        playout_bench --scaling [positions] [playouts per move] [max threads]
+ *        playout_bench --memory [positions] [playouts per move] [MB]
+ *        playout_bench --graph [positions] [playouts per move] [threads]
+ *
+ * --heavy runs every engine with random and with heavy playouts, to weigh the slower
+ * heavy playouts against what they gain per playout.
+ * --scaling runs the tree parallel MCTS with 1, 2, 4, ... threads and prints the speed-up.
+ * The engines are seeded, so the move checksum only changes with the thread count.
+ * --memory runs MCTS without a cap and with its tree capped at a few MB (default 1), so
+ * the tree fills up and is pruned several times a move, as under --mcts-memory.
+ * --graph runs MCTS as a tree and as a graph (MCTS::setGraph), and prints the nodes each
+ * keeps per search: a graph has fewer by the transpositions it merged.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+
+using namespace std;
+
+#include "../algorithms/montecarlo/MCTS.h"
+#include "../algorithms/montecarlo/MonteCarlo.h"
+
+const int BENCH_DEFAULT_POSITIONS = 50;
+const int BENCH_DEFAULT_PLAYOUTS = 9000;
+const int BENCH_MIN_PLIES = 4;
+const int BENCH_MAX_PLIES = 12;
+const int BENCH_DEFAULT_MAX_THREADS = 16;
+const int BENCH_DEFAULT_MEMORY_MB = 1;
+
+/**
+ * @brief Small LCG so the positions don't depend on rand(), which the engines reseed.
+ */
+uint32_t benchRandom(uint64_t &state)
+{
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (uint32_t)(state >> 33);
+}
+
+/**
+ * @brief Plays random moves on an empty grid until a running position is reached.
+ *
+ * @param grid Receives the position.
+ * @param currentBoard Receives the board to move on.
+ * @return The player to move.
+ */
+int makePosition(TicTacToe (*grid)[3][3], Coordinate *currentBoard, uint64_t &state)
+{
+    while (true)
+    {
+        // Cleared first, so a retry after a game that ended early starts from an empty grid too.
+        for (int b = 0; b < 9; b++)
+            (*grid)[b / 3][b % 3] = TicTacToe();
+
+        Coordinate start(1, 1);
+        Position position = Position::fromGrid(grid, &start, 1);
+        int plies = BENCH_MIN_PLIES + benchRandom(state) % (BENCH_MAX_PLIES - BENCH_MIN_PLIES + 1);
+
+        for (int i = 0; i < plies && position.isRunning(); i++)
+        {
+            if (position.board == POSITION_ANY_BOARD)
+            {
+                uint16_t open = position.openBoards();
+                position.setBoard(BitBoard::nthSetBit(open, benchRandom(state) % BitBoard::popCount(open)));
+            }
+
+            int b = position.board;
+            uint16_t empty = position.emptyCells(b);
+            int cell = BitBoard::nthSetBit(empty, benchRandom(state) % BitBoard::popCount(empty));
+
+            (*grid)[b / 3][b % 3].addMove(cell / 3, cell % 3, position.toMove);
+            position.play(b, cell);
+        }
+
+        if (!position.isRunning() || position.board == POSITION_ANY_BOARD)
+            continue;
+
+        currentBoard->x = position.board / 3;
+        currentBoard->y = position.board % 3;
+        return position.toMove;
+    }
+}
+
+/**
+ * @brief Runs one engine on every position and prints its playouts per second.
+ *
+ * @param configure Sets engine options the arguments don't cover, or nullptr.
+ * @return The playouts per second.
+ */
+template <typename Engine>
+double bench(const char *name, int numPositions, int enginePlayouts, int numThreads,
+             const PlayoutPolicy &policy = PlayoutPolicy(), const function<void(Engine &)> &configure = nullptr)
+{
+    uint64_t state = 0x5eed;
+    uint64_t checksum = 0;
+    long long playouts = 0, steps = 0;
+    double elapsedMs = 0;
+
+    for (int i = 0; i < numPositions; i++)
+    {
+        TicTacToe grid[3][3];
+        Coordinate currentBoard(0, 0);
+        int player = makePosition(&grid, &currentBoard, state);
+
+        Engine engine(&grid, player, enginePlayouts);
+        engine.setNumThreads(numThreads);
+        engine.setPlayoutPolicy(policy);
+        engine.setSeed(i);
+        if (configure)
+            configure(engine);
+
+        int x, y;
+        engine.useAlgorithm(&x, &y, &currentBoard);
+        checksum = checksum * 31 + x * 3 + y;
+
+        playouts += engine.getStats().playouts;
+        steps += engine.getStats().nodes;
+        elapsedMs += engine.getStats().elapsedMs;
+    }
+
+    // Steps are the moves played, which shows how long the playouts are.
+    double seconds = elapsedMs / 1000.0;
+    printf("%-12s %10lld playouts %10.1f ms %12.0f playouts/s %12.0f steps/s  moves %016llx\n", name, playouts,
+           elapsedMs, playouts / seconds, steps / seconds, (unsigned long long)checksum);
+
+    return playouts / seconds;
+}
+
+/**
+ * @brief Runs MCTS with 1, 2, 4, ... threads and prints the speed-up over one thread.
+ */
+void benchScaling(int numPositions, int playoutsPerMove, int maxThreads)
+{
+    printf("%d positions, %d playouts per move, %d hardware threads\n", numPositions, playoutsPerMove,
+           ThreadPool::defaultNumThreads());
+
+    double single = 0;
+    for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "MCTS x%d", numThreads);
+
+        double rate = bench<MCTS>(name, numPositions, playoutsPerMove, numThreads);
+        if (numThreads == 1)
+            single = rate;
+
+        printf("%12s speed-up %.2f, efficiency %.0f%%\n", "", rate / single, 100.0 * rate / single / numThreads);
+    }
+}
+
+/**
+ * @brief Runs MCTS without and with a memory cap on its tree.
+ */
+void benchMemory(int numPositions, int playoutsPerMove, int megabytes)
+{
+    size_t bytes = (size_t)megabytes << 20;
+    printf("%d positions, %d playouts per move, tree capped at %d MB (%u nodes)\n", numPositions, playoutsPerMove,
+           megabytes, MCTSArena::getCapacity(bytes, false));
+
+    bench<MCTS>("MCTS", numPositions, playoutsPerMove, 1);
+
+    char name[32];
+    snprintf(name, sizeof(name), "MCTS %d MB", megabytes);
+    bench<MCTS>(name, numPositions, playoutsPerMove, 1, PlayoutPolicy(), [bytes](MCTS &engine)
+                { engine.setMemoryLimit(bytes); });
+}
+
+/**
+ * @brief Runs MCTS as a tree and as a graph on every position and prints the nodes per search of each.
+ */
+void benchGraph(int numPositions, int playoutsPerMove, int numThreads)
+{
+    printf("%d positions, %d playouts per move, %d threads\n", numPositions, playoutsPerMove,
+           numThreads > 0 ? numThreads : ThreadPool::defaultNumThreads());
+
+    for (int graph = 0; graph < 2; graph++)
+    {
+        uint64_t state = 0x5eed;
+        uint64_t checksum = 0;
+        long long playouts = 0, nodes = 0;
+        double elapsedMs = 0;
+
+        for (int i = 0; i < numPositions; i++)
+        {
+            TicTacToe grid[3][3];
+            Coordinate currentBoard(0, 0);
+            int player = makePosition(&grid, &currentBoard, state);
+
+            MCTS engine(&grid, player, playoutsPerMove);
+            engine.setNumThreads(numThreads);
+            engine.setGraph(graph == 1);
+            engine.setSeed(i);
+
+            int x, y;
+            engine.useAlgorithm(&x, &y, &currentBoard);
+            checksum = checksum * 31 + x * 3 + y;
+
+            playouts += engine.getStats().playouts;
+            nodes += engine.getTreeNodes();
+            elapsedMs += engine.getStats().elapsedMs;
+        }
+
+        printf("%-12s %10lld playouts %10.1f ms %12.0f playouts/s %10.0f nodes per search  moves %016llx\n",
+               graph ? "MCTS graph" : "MCTS tree", playouts, elapsedMs, playouts / (elapsedMs / 1000.0),
+               (double)nodes / numPositions, (unsigned long long)checksum);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "--scaling") == 0)
+    {
+        int numPositions = argc > 2 ? atoi(argv[2]) : BENCH_DEFAULT_POSITIONS;
+        int playoutsPerMove = argc > 3 ? atoi(argv[3]) : BENCH_DEFAULT_PLAYOUTS;
+        int maxThreads = argc > 4 ? atoi(argv[4]) : BENCH_DEFAULT_MAX_THREADS;
+
+        benchScaling(numPositions, playoutsPerMove, maxThreads);
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--graph") == 0)
+    {
+        int numPositions = argc > 2 ? atoi(argv[2]) : BENCH_DEFAULT_POSITIONS;
+        int playoutsPerMove = argc > 3 ? atoi(argv[3]) : BENCH_DEFAULT_PLAYOUTS;
+        int numThreads = argc > 4 ? atoi(argv[4]) : 1;
+
+        benchGraph(numPositions, playoutsPerMove, numThreads);
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--memory") == 0)
+    {
+        int numPositions = argc > 2 ? atoi(argv[2]) : BENCH_DEFAULT_POSITIONS;
+        int playoutsPerMove = argc > 3 ? atoi(argv[3]) : BENCH_DEFAULT_PLAYOUTS;
+        int megabytes = argc > 4 ? atoi(argv[4]) : BENCH_DEFAULT_MEMORY_MB;
+
+        benchMemory(numPositions, playoutsPerMove, megabytes);
+        return 0;
+    }
+
+    bool heavy = argc > 1 && strcmp(argv[1], "--heavy") == 0;
+    if (heavy)
+    {
+        argc--;
+        argv++;
+    }
+
+    int numPositions = argc > 1 ? atoi(argv[1]) : BENCH_DEFAULT_POSITIONS;
+    int playoutsPerMove = argc > 2 ? atoi(argv[2]) : BENCH_DEFAULT_PLAYOUTS;
+    int numThreads = argc > 3 ? atoi(argv[3]) : 1;
+
+    if (numPositions < 1 || playoutsPerMove < 9 || numThreads < 0)
+    {
+        cerr << "Usage: " << argv[0] << " [positions] [playouts per move (>= 9)] [threads (0 = all cores)]" << endl;
+        return 1;
+    }
+
+    printf("%d positions, %d playouts per move, %d threads\n", numPositions, playoutsPerMove,
+           numThreads > 0 ? numThreads : ThreadPool::defaultNumThreads());
+
+    // Monte Carlo runs its simulations for each of the (at most 9) candidate moves.
+    bench<MonteCarlo>("Monte Carlo", numPositions, playoutsPerMove / 9, numThreads);
+    bench<MCTS>("MCTS", numPositions, playoutsPerMove, numThreads);
+
+    if (heavy)
+    {
+        PlayoutPolicy policy(true, PlayoutPolicy().epsilon);
+        bench<MonteCarlo>("MC heavy", numPositions, playoutsPerMove / 9, numThreads, policy);
+        bench<MCTS>("MCTS heavy", numPositions, playoutsPerMove, numThreads, policy);
+    }
+
+    return 0;
+}
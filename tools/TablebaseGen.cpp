@@ -0,0 +1,297 @@
+/*
+ * TablebaseGen.cpp
+ *
+ * Builds the endgame tablebase read by Advanced_Minimax (see algorithms/minimax/Tablebase.h):
+ * the value of every position with at most K empty cells.
+ *
+ * Build: g++ -O2 -pthread -o tablebase_gen tools/TablebaseGen.cpp
+ * Usage: tablebase_gen <output file> [max empty cells] [threads]
+ *
+ * The values are worked out backwards by retrograde analysis. Every move fills a cell, so
+ * the positions with k empty cells only lead to positions with k - 1, and the layers are
+ * solved from 1 empty cell up to K, each from the one below it. Positions are visited up
+ * to symmetry: only the sets of empty cells that come first among their 8 images, and of
+ * the positions on them only those whose key is the canonical one.
+ *
+ * K = 3 (the default) gives about 2 million positions in a few seconds. K = 4 gives about
+ * 180 million, a 1.8 GB file, and needs around 8 GB of memory to build.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+#include "../algorithms/minimax/Tablebase.h"
+#include "../helpers/ThreadPool.h"
+
+typedef pair<uint64_t, double> TablebaseEntry;
+
+/**
+ * @brief The solved positions of one layer, sorted by key.
+ */
+struct TablebaseLayer
+{
+    vector<uint64_t> keys;
+    vector<double> values;
+};
+
+/**
+ * @brief Packs a set of empty cells seen through a symmetry like the top of a key.
+ */
+uint64_t packCells(const int *cells, int count, int symmetry)
+{
+    int mapped[TABLEBASE_MAX_EMPTIES];
+    for (int i = 0; i < count; i++)
+        mapped[i] = Symmetry::move(symmetry, cells[i]);
+    TablebaseState::sortCells(mapped, count);
+
+    uint64_t packed = 0;
+    for (int i = 0; i < TABLEBASE_MAX_EMPTIES; i++)
+        packed = packed << TABLEBASE_CELL_BITS | (uint64_t)(i < count ? mapped[i] : TABLEBASE_NO_CELL);
+    return packed;
+}
+
+/**
+ * @brief Lists the sets of k empty cells that come first among their images.
+ */
+void getEmptySets(int k, int first, int *cells, int count, vector<vector<int>> &sets)
+{
+    if (count == k)
+    {
+        uint64_t packed = packCells(cells, count, SYMMETRY_IDENTITY);
+        for (int s = 1; s < SYMMETRY_COUNT; s++)
+            if (packCells(cells, count, s) < packed)
+                return;
+
+        sets.push_back(vector<int>(cells, cells + count));
+        return;
+    }
+
+    for (int cell = first; cell < POSITION_NUM_MOVES; cell++)
+    {
+        cells[count] = cell;
+        getEmptySets(k, cell + 1, cells, count + 1, sets);
+    }
+}
+
+/**
+ * @brief Looks up a solved position of the layer below.
+ *
+ * @param missing Counts positions that were not found, which would be a bug.
+ */
+double getValue(const TablebaseLayer &layer, const TablebaseState &state, atomic<uint64_t> &missing)
+{
+    TablebaseState redirected = state;
+    double total = 0;
+    int boards = 0;
+
+    for (int b = 0; b < POSITION_NUM_BOARDS; b++)
+    {
+        if (state.board != POSITION_ANY_BOARD ? b != state.board : !state.boards[b].empty)
+            continue;
+
+        redirected.board = b;
+        uint64_t key = redirected.getCanonicalKey();
+        vector<uint64_t>::const_iterator found = lower_bound(layer.keys.begin(), layer.keys.end(), key);
+
+        if (found == layer.keys.end() || *found != key)
+            missing++;
+        else
+            total += layer.values[found - layer.keys.begin()];
+        boards++;
+    }
+
+    return total / boards;
+}
+
+/**
+ * @brief Solves a position from the layer below: the best move for the player to move.
+ */
+double solve(const TablebaseLayer &below, const TablebaseState &state, atomic<uint64_t> &missing)
+{
+    double best = -1;
+    for (uint16_t empty = state.boards[state.board].empty; empty; empty &= empty - 1)
+    {
+        TablebaseState child;
+        int result = state.play(BitBoard::lowestBit(empty), child);
+
+        if (result == TABLEBASE_MOVE_WIN)
+            return 1;
+        if (result == TABLEBASE_MOVE_DRAW)
+            best = max(best, 0.0);
+        else
+            best = max(best, -getValue(below, child, missing));
+    }
+    return best;
+}
+
+/**
+ * @brief Solves every canonical position on one set of empty cells.
+ */
+void solveEmptySet(const TablebaseLayer &below, const vector<int> &cells, vector<TablebaseEntry> &entries, atomic<uint64_t> &missing)
+{
+    TablebaseState state;
+    state.empties = (int)cells.size();
+    for (int b = 0; b < POSITION_NUM_BOARDS; b++)
+        state.boards[b].empty = state.boards[b].own = state.boards[b].enemy = 0;
+    for (size_t i = 0; i < cells.size(); i++)
+        state.boards[cells[i] / 9].empty |= (uint16_t)(1 << cells[i] % 9);
+
+    // Symmetries that map the empty cells onto themselves. Only they can give a smaller key.
+    vector<int> stabiliser;
+    uint64_t packed = packCells(cells.data(), (int)cells.size(), SYMMETRY_IDENTITY);
+    for (int s = 1; s < SYMMETRY_COUNT; s++)
+        if (packCells(cells.data(), (int)cells.size(), s) == packed)
+            stabiliser.push_back(s);
+
+    int boards[TABLEBASE_MAX_EMPTIES];
+    int numBoards = 0;
+    for (int b = 0; b < POSITION_NUM_BOARDS; b++)
+        if (state.boards[b].empty)
+            boards[numBoards++] = b;
+
+    // Every combination of options, counted like the digits of a number.
+    int digits[TABLEBASE_MAX_EMPTIES] = {0};
+    while (true)
+    {
+        for (int i = 0; i < numBoards; i++)
+        {
+            uint32_t option = TABLEBASE_TABLES.options[state.boards[boards[i]].empty][digits[i]];
+            state.boards[boards[i]].own = (uint16_t)(option >> 16);
+            state.boards[boards[i]].enemy = (uint16_t)option;
+        }
+
+        for (int i = 0; i < numBoards; i++)
+        {
+            state.board = boards[i];
+            uint64_t key = state.getKey(SYMMETRY_IDENTITY);
+
+            bool canonical = true;
+            for (size_t s = 0; s < stabiliser.size() && canonical; s++)
+                canonical = state.getKey(stabiliser[s]) >= key;
+
+            if (canonical)
+                entries.push_back(TablebaseEntry(key, solve(below, state, missing)));
+        }
+
+        int i = 0;
+        while (i < numBoards && ++digits[i] == (int)TABLEBASE_TABLES.options[state.boards[boards[i]].empty].size())
+            digits[i++] = 0;
+        if (i == numBoards)
+            break;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        cerr << "Usage: " << argv[0] << " <output file> [max empty cells] [threads]" << endl;
+        return 1;
+    }
+
+    int maxEmpties = argc > 2 ? atoi(argv[2]) : TABLEBASE_DEFAULT_EMPTIES;
+    int numThreads = argc > 3 ? atoi(argv[3]) : ThreadPool::defaultNumThreads();
+    if (maxEmpties < 1 || maxEmpties > TABLEBASE_MAX_EMPTIES)
+    {
+        cerr << "The number of empty cells must be 1 to " << TABLEBASE_MAX_EMPTIES << endl;
+        return 1;
+    }
+
+    ThreadPool pool(numThreads < 1 ? 1 : numThreads);
+    vector<TablebaseEntry> all;
+    TablebaseLayer below;
+    atomic<uint64_t> missing(0);
+
+    for (int k = 1; k <= maxEmpties; k++)
+    {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+        int cells[TABLEBASE_MAX_EMPTIES];
+        vector<vector<int>> sets;
+        getEmptySets(k, 0, cells, 0, sets);
+
+        // Workers take the sets one at a time, their sizes differ a lot.
+        vector<vector<TablebaseEntry>> found(pool.getNumThreads());
+        atomic<size_t> next(0);
+        pool.run([&](int worker)
+                 {
+                     for (size_t i = next++; i < sets.size(); i = next++)
+                         solveEmptySet(below, sets[i], found[worker], missing); });
+
+        vector<TablebaseEntry> layer;
+        for (size_t w = 0; w < found.size(); w++)
+            layer.insert(layer.end(), found[w].begin(), found[w].end());
+        sort(layer.begin(), layer.end());
+
+        uint64_t wins = 0, losses = 0, draws = 0;
+        below.keys.clear();
+        below.values.clear();
+        for (size_t i = 0; i < layer.size(); i++)
+        {
+            below.keys.push_back(layer[i].first);
+            below.values.push_back(layer[i].second);
+            wins += layer[i].second == 1;
+            losses += layer[i].second == -1;
+            draws += layer[i].second == 0;
+        }
+        all.insert(all.end(), layer.begin(), layer.end());
+
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        printf("%d empty: %zu positions (%llu won, %llu drawn, %llu lost, %llu by chance) in %.1f s\n",
+               k, layer.size(), (unsigned long long)wins, (unsigned long long)draws, (unsigned long long)losses,
+               (unsigned long long)(layer.size() - wins - draws - losses), seconds);
+    }
+
+    if (missing != 0)
+    {
+        cerr << missing << " positions were missing from the layer below" << endl;
+        return 1;
+    }
+
+    sort(all.begin(), all.end());
+
+    FILE *file = fopen(argv[1], "wb");
+    if (file == nullptr)
+    {
+        cerr << "Could not open " << argv[1] << endl;
+        return 1;
+    }
+
+    TablebaseHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = TABLEBASE_MAGIC;
+    header.version = TABLEBASE_VERSION;
+    header.keySize = sizeof(uint64_t);
+    header.valueSize = sizeof(int16_t);
+    header.maxEmpties = (uint32_t)maxEmpties;
+    header.count = all.size();
+
+    vector<uint64_t> keys(all.size());
+    vector<int16_t> values(all.size());
+    for (size_t i = 0; i < all.size(); i++)
+    {
+        keys[i] = all[i].first;
+        values[i] = (int16_t)lround(all[i].second * TABLEBASE_VALUE_SCALE);
+    }
+
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   fwrite(keys.data(), sizeof(uint64_t), keys.size(), file) == keys.size() &&
+                   fwrite(values.data(), sizeof(int16_t), values.size(), file) == values.size();
+    written = fclose(file) == 0 && written;
+
+    if (!written)
+    {
+        cerr << "Could not write " << argv[1] << endl;
+        return 1;
+    }
+
+    printf("Wrote %zu positions to %s\n", all.size(), argv[1]);
+    return 0;
+}
@@ -0,0 +1,118 @@
+/*
+ * TraceReader.cpp
+ *
+ * Reads a search trace written by Advanced_Minimax (see algorithms/minimax/SearchTrace.h)
+ * and prints the subtree sizes by root move and depth.
+ *
+ * Build: g++ -O2 -o trace_reader tools/TraceReader.cpp
+ * Usage: trace_reader <trace file>
+ */
+
+#include <cstdio>
+#include <iostream>
+#include <map>
+
+using namespace std;
+
+#include "../algorithms/minimax/SearchTrace.h"
+
+const int TRACE_READER_MAX_DEPTH = 256;
+
+/**
+ * @brief Totals of one root move.
+ */
+struct RootMoveSummary
+{
+    unsigned long long nodes[TRACE_READER_MAX_DEPTH];
+    unsigned long long cutoffs[TRACE_READER_MAX_DEPTH];
+    unsigned long long leaves;
+    int maxDepth;
+
+    RootMoveSummary() : nodes(), cutoffs(), leaves(0), maxDepth(0) {}
+};
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        cerr << "Usage: " << argv[0] << " <trace file>" << endl;
+        return 1;
+    }
+
+    FILE *file = fopen(argv[1], "rb");
+    if (file == nullptr)
+    {
+        cerr << "Could not open " << argv[1] << endl;
+        return 1;
+    }
+
+    TraceHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != TRACE_MAGIC ||
+        header.version != TRACE_VERSION || header.recordSize != sizeof(TraceRecord))
+    {
+        cerr << "Not a version " << TRACE_VERSION << " search trace: " << argv[1] << endl;
+        fclose(file);
+        return 1;
+    }
+
+    // Aggregate every record by its root move and depth.
+    map<int, RootMoveSummary> summaries;
+    unsigned long long totalRecords = 0;
+    TraceRecord records[TRACE_BUFFER_RECORDS];
+    size_t count;
+
+    while ((count = fread(records, sizeof(TraceRecord), TRACE_BUFFER_RECORDS, file)) > 0)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            const TraceRecord &record = records[i];
+            RootMoveSummary &summary = summaries[record.rootMove];
+
+            summary.nodes[record.depth]++;
+            if (record.flags & TRACE_FLAG_CUTOFF)
+                summary.cutoffs[record.depth]++;
+            if (record.flags & TRACE_FLAG_LEAF)
+                summary.leaves++;
+            if (record.depth > summary.maxDepth)
+                summary.maxDepth = record.depth;
+        }
+
+        totalRecords += count;
+    }
+
+    fclose(file);
+
+    // Sampled traces only hold one in sampleEvery nodes, scale the counts back up.
+    unsigned long long scale = header.sampleEvery;
+
+    cout << "Records: " << totalRecords
+         << "  (max depth " << header.maxDepth << ", sampling 1/" << header.sampleEvery << ")" << endl
+         << endl;
+
+    for (map<int, RootMoveSummary>::iterator it = summaries.begin(); it != summaries.end(); ++it)
+    {
+        int move = it->first;
+        const RootMoveSummary &summary = it->second;
+
+        unsigned long long subtree = 0;
+        for (int depth = 0; depth <= summary.maxDepth; depth++)
+            subtree += summary.nodes[depth];
+
+        cout << "Root move board " << move / 9 / 3 + 1 << "," << move / 9 % 3 + 1
+             << " cell " << move % 9 / 3 + 1 << "," << move % 9 % 3 + 1
+             << ": ~" << subtree * scale << " nodes, ~" << summary.leaves * scale << " leaves" << endl;
+
+        for (int depth = 1; depth <= summary.maxDepth; depth++)
+        {
+            if (summary.nodes[depth] == 0)
+                continue;
+
+            cout << "    depth " << depth
+                 << ": ~" << summary.nodes[depth] * scale << " nodes"
+                 << ", cutoff rate " << (double)summary.cutoffs[depth] / summary.nodes[depth]
+                 << endl;
+        }
+    }
+
+    return 0;
+}